@@ -0,0 +1,181 @@
+/*
+	==============================================================================
+
+	BatchRenderer
+	by Daniel Rothmann
+
+	Renders many audio files through one plugin description across parallel workers
+
+	==============================================================================
+*/
+
+#include "BatchRenderer.h"
+
+/**
+*Constructs a batch renderer.
+*@param numWorkerThreads The number of files rendered at once. If not positive, one worker per CPU core is used.
+*@param renderBlockSize The number of samples processed at once.
+*/
+BatchRenderer::BatchRenderer(int numWorkerThreads, int renderBlockSize)
+	: numWorkers(numWorkerThreads > 0 ? numWorkerThreads : SystemStats::getNumCpus()), blockSize(jmax(1, renderBlockSize))
+{
+}
+
+BatchRenderer::~BatchRenderer()
+{
+}
+
+/**
+*Renders every input file through the plugin into an output directory, keeping file names. Input files sharing a name,
+*for example from different directories of a manifest, get a numbered suffix so none overwrites another. Returns once every file is done.
+*@param xmlPluginDescription A string containing the XML Document which can be read as a PluginDescription.
+*@param inputFiles The audio files to render.
+*@param outputDirectory The directory to write rendered files to. It is created if missing.
+*@param callback A function called from the worker threads after each file. May be null.
+*@return A report of the files rendered and the throughput achieved.
+*/
+BatchReport BatchRenderer::renderBatch(char* xmlPluginDescription, const Array<File>& inputFiles, const File& outputDirectory, BatchFileCallback callback)
+{
+	pluginDescription = String(xmlPluginDescription);
+	files = inputFiles;
+	outputFolder = outputDirectory;
+	fileCallback = callback;
+
+	nextFile.store(0);
+	numRendered.store(0);
+	numFailed.store(0);
+	audioSeconds = 0.0;
+
+	outputFolder.createDirectory();
+	chooseOutputFiles();
+
+	const double startTime = Time::getMillisecondCounterHiRes();
+	OwnedArray<Worker> workers;
+
+	for (int worker = 0; worker < jmin(numWorkers, files.size()); worker++)
+		workers.add(new Worker(*this))->startThread();
+
+	for (auto* worker : workers)
+		worker->waitForThreadToExit(-1);
+
+	BatchReport report;
+	report.numFilesRendered = numRendered.load();
+	report.numFilesFailed = numFailed.load();
+	report.numWorkers = jmax(1, workers.size());
+	report.audioSeconds = audioSeconds;
+	report.wallClockSeconds = (Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+	report.realtimeFactor = report.wallClockSeconds > 0.0 ? report.audioSeconds / report.wallClockSeconds : 0.0;
+	report.realtimeFactorPerWorker = report.realtimeFactor / report.numWorkers;
+	return report;
+}
+
+/**
+*Collects the audio files to render from a directory, or from a manifest file listing one path per line.
+*@param directoryOrManifest A directory whose audio files should be rendered, or a text file listing them.
+*@return The files found. Lines of a manifest which don't name existing files are skipped.
+*/
+Array<File> BatchRenderer::findInputFiles(const File& directoryOrManifest)
+{
+	Array<File> inputFiles;
+
+	if (directoryOrManifest.isDirectory())
+	{
+		AudioFormatManager formatManager;
+		formatManager.registerBasicFormats();
+		directoryOrManifest.findChildFiles(inputFiles, File::findFiles, false, formatManager.getWildcardForAllFormats());
+		inputFiles.sort();
+	}
+	else
+	{
+		StringArray lines;
+		directoryOrManifest.readLines(lines);
+
+		for (auto& line : lines)
+		{
+			const File file(line.trim());
+
+			if (line.trim().isNotEmpty() && file.existsAsFile())
+				inputFiles.add(file);
+		}
+	}
+
+	return inputFiles;
+}
+
+/**
+*Chooses a distinct output file for every input file before any worker starts, so workers never write the same file.
+*The first input with a name keeps it, and later ones get " (2)", " (3)" and so on before the extension.
+*/
+void BatchRenderer::chooseOutputFiles()
+{
+	outputFiles.clearQuick();
+	StringArray usedNames;
+
+	for (auto& inputFile : files)
+	{
+		String name = inputFile.getFileName();
+
+		for (int suffix = 2; usedNames.contains(name, true); suffix++)
+			name = inputFile.getFileNameWithoutExtension() + " (" + String(suffix) + ")" + inputFile.getFileExtension();
+
+		usedNames.add(name);
+		outputFiles.add(outputFolder.getChildFile(name));
+	}
+}
+
+/**
+*Instantiates the plugin for the calling worker and renders files until none are left.
+*/
+void BatchRenderer::renderFiles()
+{
+	PluginHost host;
+	OfflineRenderer renderer(blockSize);
+	host.setHeadless(true);
+	const bool instantiated = host.instantiatePlugin(pluginDescription.toRawUTF8(), 44100.0, blockSize);
+
+	for (int index = nextFile.fetch_add(1); index < files.size(); index = nextFile.fetch_add(1))
+	{
+		const File& inputFile = files.getReference(index);
+		const double startTime = Time::getMillisecondCounterHiRes();
+
+		// Clear any tails and internal state left over from the previous file.
+		host.resetPlugin();
+		const bool succeeded = instantiated && renderer.renderFile(host, inputFile, outputFiles.getReference(index));
+
+		const double renderSeconds = (Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+		double fileSeconds = 0.0;
+
+		if (succeeded)
+		{
+			fileSeconds = renderer.getNumSamplesRendered() / renderer.getSampleRate();
+			numRendered++;
+
+			const ScopedLock lock(statisticsLock);
+			audioSeconds += fileSeconds;
+		}
+		else
+		{
+			numFailed++;
+		}
+
+		if (fileCallback != nullptr)
+			fileCallback(index, inputFile.getFullPathName().toRawUTF8(), succeeded, renderSeconds,
+						 renderSeconds > 0.0 ? fileSeconds / renderSeconds : 0.0);
+	}
+
+	host.releasePlugin();
+}
+
+/**
+*Constructs a worker thread rendering files of a batch.
+*@param owner The batch to render.
+*/
+BatchRenderer::Worker::Worker(BatchRenderer& owner)
+	: Thread("BatchRenderer worker"), batch(owner)
+{
+}
+
+void BatchRenderer::Worker::run()
+{
+	batch.renderFiles();
+}
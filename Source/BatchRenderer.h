@@ -0,0 +1,79 @@
+/*
+	==============================================================================
+
+	BatchRenderer
+	by Daniel Rothmann
+
+	Renders many audio files through one plugin description across parallel workers
+
+	==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PluginHost.h"
+#include "OfflineRenderer.h"
+#include <atomic>
+
+/**
+* Called from a worker thread each time a file has been rendered.
+*/
+typedef void (*BatchFileCallback)(int fileIndex, const char* inputPath, bool succeeded, double renderSeconds, double realtimeFactor);
+
+/**
+* Throughput of a finished batch, laid out for copying across the C API.
+*/
+struct BatchReport
+{
+	int32 numFilesRendered;
+	int32 numFilesFailed;
+	int32 numWorkers;
+	double audioSeconds;
+	double wallClockSeconds;
+	double realtimeFactor;
+	double realtimeFactorPerWorker;
+};
+
+/**
+* Renders many audio files through one plugin description. Each worker thread instantiates the plugin once
+* and reuses it for every file it takes, resetting it in between.
+*/
+class BatchRenderer
+{
+public:
+	BatchRenderer(int numWorkers, int blockSize);
+	~BatchRenderer();
+
+	BatchReport renderBatch(char* xmlPluginDescription, const Array<File>& inputFiles, const File& outputDirectory, BatchFileCallback callback);
+
+	static Array<File> findInputFiles(const File& directoryOrManifest);
+
+private:
+	class Worker : public Thread
+	{
+	public:
+		Worker(BatchRenderer& owner);
+		void run() override;
+
+	private:
+		BatchRenderer& batch;
+	};
+
+	void renderFiles();
+	void chooseOutputFiles();
+
+	const int numWorkers;
+	const int blockSize;
+
+	String pluginDescription;
+	Array<File> files;
+	Array<File> outputFiles;
+	File outputFolder;
+	BatchFileCallback fileCallback = nullptr;
+
+	std::atomic<int> nextFile { 0 };
+	std::atomic<int> numRendered { 0 };
+	std::atomic<int> numFailed { 0 };
+	CriticalSection statisticsLock;
+	double audioSeconds = 0.0;
+};
@@ -0,0 +1,98 @@
+/*
+	==============================================================================
+
+	BlockWorkerGroup
+	by Daniel Rothmann
+
+	A fixed group of worker threads which join the calling thread in processing each audio block
+
+	==============================================================================
+*/
+
+#include "BlockWorkerGroup.h"
+
+/**
+*Constructs the group and starts its worker threads.
+*@param blockJob The work to run for every participant of each block. Must outlive the group.
+*@param threadName The name of the worker threads, followed by their participant index.
+*@param numWorkers The number of worker threads helping the calling thread.
+*@param pinThreadsToCores Wether each worker thread should be restricted to its own CPU core.
+*/
+BlockWorkerGroup::BlockWorkerGroup(Job& blockJob, const String& threadName, int numWorkers, bool pinThreadsToCores)
+	: job(blockJob)
+{
+	for (int participant = 1; participant <= jmax(0, numWorkers); participant++)
+	{
+		auto* worker = workers.add(new Worker(*this, threadName, participant));
+
+		if (pinThreadsToCores)
+			worker->setAffinityMask((uint32) 1 << (participant % jmin(32, SystemStats::getNumCpus())));
+
+		worker->startThread(9);
+	}
+}
+
+BlockWorkerGroup::~BlockWorkerGroup()
+{
+	for (auto* worker : workers)
+	{
+		worker->signalThreadShouldExit();
+		worker->blockStarted.signal();
+	}
+
+	for (auto* worker : workers)
+		worker->stopThread(1000);
+}
+
+/**
+*Runs the job for every participant, doing participant 0 on the calling thread, and returns once all have finished.
+*/
+void BlockWorkerGroup::runBlock()
+{
+	busyWorkers.store(workers.size(), std::memory_order_relaxed);
+	generation.fetch_add(1, std::memory_order_release);
+
+	for (auto* worker : workers)
+		worker->blockStarted.signal();
+
+	job.runParticipant(0);
+
+	// Wait until every worker has left the block before anything it used is reused.
+	while (busyWorkers.load(std::memory_order_acquire) > 0)
+		Thread::yield();
+}
+
+/**
+*Constructs a worker thread taking part in processing blocks.
+*@param owner The group the worker belongs to.
+*@param threadName The name of the thread, followed by the participant index.
+*@param participantIndex The participant index the worker runs the job for.
+*/
+BlockWorkerGroup::Worker::Worker(BlockWorkerGroup& owner, const String& threadName, int participantIndex)
+	: Thread(threadName + " " + String(participantIndex)), group(owner), participant(participantIndex)
+{
+}
+
+/**
+*Waits for blocks to start and runs the job for them. Spins briefly before sleeping so back-to-back blocks don't pay for a wake-up.
+*/
+void BlockWorkerGroup::Worker::run()
+{
+	while (!threadShouldExit())
+	{
+		for (int spin = 0; spin < 256 && group.generation.load(std::memory_order_acquire) == lastGeneration; spin++)
+			Thread::yield();
+
+		const int currentGeneration = group.generation.load(std::memory_order_acquire);
+
+		if (currentGeneration == lastGeneration)
+		{
+			blockStarted.wait(100);
+			continue;
+		}
+
+		lastGeneration = currentGeneration;
+		group.job.runParticipant(participant);
+		group.busyWorkers.fetch_sub(1, std::memory_order_release);
+	}
+}
@@ -0,0 +1,58 @@
+/*
+	==============================================================================
+
+	BlockWorkerGroup
+	by Daniel Rothmann
+
+	A fixed group of worker threads which join the calling thread in processing each audio block
+
+	==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+/**
+* A fixed group of worker threads which join the thread calling runBlock in processing each block.
+* The calling thread is participant 0 and the workers are participants 1 and up. runBlock returns once every
+* participant has finished its share, so state set up before the call can be reused right after it.
+*/
+class BlockWorkerGroup
+{
+public:
+	/**
+	* The work each participant does for a block.
+	*/
+	class Job
+	{
+	public:
+		virtual ~Job() {}
+		virtual void runParticipant(int participant) = 0;
+	};
+
+	BlockWorkerGroup(Job& blockJob, const String& threadName, int numWorkers, bool pinThreadsToCores);
+	~BlockWorkerGroup();
+
+	void runBlock();
+
+private:
+	class Worker : public Thread
+	{
+	public:
+		Worker(BlockWorkerGroup& owner, const String& threadName, int participantIndex);
+		void run() override;
+
+		WaitableEvent blockStarted;
+
+	private:
+		BlockWorkerGroup& group;
+		const int participant;
+		int lastGeneration = 0;
+	};
+
+	Job& job;
+	OwnedArray<Worker> workers;
+	std::atomic<int> generation { 0 };
+	std::atomic<int> busyWorkers { 0 };
+};
@@ -0,0 +1,246 @@
+/*
+	==============================================================================
+
+	InterleavedAudio
+	by Daniel Rothmann
+
+	Conversion kernels between interleaved frames and planar channels
+
+	==============================================================================
+*/
+
+#include "InterleavedAudio.h"
+
+#if JUCE_INTEL
+ #include <xmmintrin.h>
+ #define INTERLEAVED_AUDIO_USE_SSE 1
+#else
+ #define INTERLEAVED_AUDIO_USE_SSE 0
+#endif
+
+namespace
+{
+	/**
+	*Scalar kernel with the channel count known at compile time, so the compiler can unroll the inner loop.
+	*/
+	template <int NumChannels>
+	struct Kernel
+	{
+		static void deinterleave(const float* source, float* const* destination, int startSample, int numSamples)
+		{
+			for (int sample = startSample; sample < numSamples; sample++)
+				for (int channel = 0; channel < NumChannels; channel++)
+					destination[channel][sample] = source[sample * NumChannels + channel];
+		}
+
+		static void interleave(const float* const* source, float* destination, int startSample, int numSamples)
+		{
+			for (int sample = startSample; sample < numSamples; sample++)
+				for (int channel = 0; channel < NumChannels; channel++)
+					destination[sample * NumChannels + channel] = source[channel][sample];
+		}
+	};
+
+	template <>
+	struct Kernel<1>
+	{
+		static void deinterleave(const float* source, float* const* destination, int startSample, int numSamples)
+		{
+			if (destination[0] != source && numSamples > startSample)
+				FloatVectorOperations::copy(destination[0] + startSample, source + startSample, numSamples - startSample);
+		}
+
+		static void interleave(const float* const* source, float* destination, int startSample, int numSamples)
+		{
+			if (source[0] != destination && numSamples > startSample)
+				FloatVectorOperations::copy(destination + startSample, source[0] + startSample, numSamples - startSample);
+		}
+	};
+
+#if INTERLEAVED_AUDIO_USE_SSE
+	void deinterleaveStereo(const float* source, float* const* destination, int numSamples)
+	{
+		float* left = destination[0];
+		float* right = destination[1];
+		const int numVectorSamples = numSamples & ~3;
+
+		for (int sample = 0; sample < numVectorSamples; sample += 4)
+		{
+			const __m128 first = _mm_loadu_ps(source + sample * 2);
+			const __m128 second = _mm_loadu_ps(source + sample * 2 + 4);
+			_mm_storeu_ps(left + sample, _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(right + sample, _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+
+		Kernel<2>::deinterleave(source, destination, numVectorSamples, numSamples);
+	}
+
+	void interleaveStereo(const float* const* source, float* destination, int numSamples)
+	{
+		const float* left = source[0];
+		const float* right = source[1];
+		const int numVectorSamples = numSamples & ~3;
+
+		for (int sample = 0; sample < numVectorSamples; sample += 4)
+		{
+			const __m128 l = _mm_loadu_ps(left + sample);
+			const __m128 r = _mm_loadu_ps(right + sample);
+			_mm_storeu_ps(destination + sample * 2, _mm_unpacklo_ps(l, r));
+			_mm_storeu_ps(destination + sample * 2 + 4, _mm_unpackhi_ps(l, r));
+		}
+
+		Kernel<2>::interleave(source, destination, numVectorSamples, numSamples);
+	}
+
+	/**
+	*Transposes blocks of 4 frames by 4 channels. Handles any multiple of 4 channels, one group of 4 at a time.
+	*/
+	template <int NumChannels>
+	void deinterleaveQuads(const float* source, float* const* destination, int numSamples)
+	{
+		const int numVectorSamples = numSamples & ~3;
+
+		for (int sample = 0; sample < numVectorSamples; sample += 4)
+		{
+			const float* frame = source + sample * NumChannels;
+
+			for (int group = 0; group < NumChannels; group += 4)
+			{
+				__m128 row0 = _mm_loadu_ps(frame + group);
+				__m128 row1 = _mm_loadu_ps(frame + group + NumChannels);
+				__m128 row2 = _mm_loadu_ps(frame + group + NumChannels * 2);
+				__m128 row3 = _mm_loadu_ps(frame + group + NumChannels * 3);
+				_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+				_mm_storeu_ps(destination[group] + sample, row0);
+				_mm_storeu_ps(destination[group + 1] + sample, row1);
+				_mm_storeu_ps(destination[group + 2] + sample, row2);
+				_mm_storeu_ps(destination[group + 3] + sample, row3);
+			}
+		}
+
+		Kernel<NumChannels>::deinterleave(source, destination, numVectorSamples, numSamples);
+	}
+
+	template <int NumChannels>
+	void interleaveQuads(const float* const* source, float* destination, int numSamples)
+	{
+		const int numVectorSamples = numSamples & ~3;
+
+		for (int sample = 0; sample < numVectorSamples; sample += 4)
+		{
+			float* frame = destination + sample * NumChannels;
+
+			for (int group = 0; group < NumChannels; group += 4)
+			{
+				__m128 row0 = _mm_loadu_ps(source[group] + sample);
+				__m128 row1 = _mm_loadu_ps(source[group + 1] + sample);
+				__m128 row2 = _mm_loadu_ps(source[group + 2] + sample);
+				__m128 row3 = _mm_loadu_ps(source[group + 3] + sample);
+				_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+				_mm_storeu_ps(frame + group, row0);
+				_mm_storeu_ps(frame + group + NumChannels, row1);
+				_mm_storeu_ps(frame + group + NumChannels * 2, row2);
+				_mm_storeu_ps(frame + group + NumChannels * 3, row3);
+			}
+		}
+
+		Kernel<NumChannels>::interleave(source, destination, numVectorSamples, numSamples);
+	}
+#endif
+}
+
+/**
+*Splits interleaved frames into planar channels.
+*@param source The interleaved frames to read from.
+*@param sourceChannels The number of channels in each interleaved frame.
+*@param destination An array of pointers to the planar channels to write to.
+*@param numChannels The number of planar channels to write. Must not exceed sourceChannels.
+*@param numSamples The number of frames to convert.
+*/
+void InterleavedAudio::deinterleave(const float* source, int sourceChannels, float* const* destination, int numChannels, int numSamples)
+{
+	jassert(numChannels <= sourceChannels);
+
+	if (numChannels == sourceChannels)
+	{
+		switch (numChannels)
+		{
+			case 1: Kernel<1>::deinterleave(source, destination, 0, numSamples); return;
+			case 6: Kernel<6>::deinterleave(source, destination, 0, numSamples); return;
+		#if INTERLEAVED_AUDIO_USE_SSE
+			case 2: deinterleaveStereo(source, destination, numSamples); return;
+			case 4: deinterleaveQuads<4>(source, destination, numSamples); return;
+			case 8: deinterleaveQuads<8>(source, destination, numSamples); return;
+		#else
+			case 2: Kernel<2>::deinterleave(source, destination, 0, numSamples); return;
+			case 4: Kernel<4>::deinterleave(source, destination, 0, numSamples); return;
+			case 8: Kernel<8>::deinterleave(source, destination, 0, numSamples); return;
+		#endif
+			default: break;
+		}
+	}
+
+	deinterleaveScalar(source, sourceChannels, destination, numChannels, numSamples);
+}
+
+/**
+*Merges planar channels into interleaved frames. Channels of the frame beyond numChannels are left untouched.
+*@param source An array of pointers to the planar channels to read from.
+*@param numChannels The number of planar channels to read. Must not exceed destinationChannels.
+*@param destination The interleaved frames to write to.
+*@param destinationChannels The number of channels in each interleaved frame.
+*@param numSamples The number of frames to convert.
+*/
+void InterleavedAudio::interleave(const float* const* source, int numChannels, float* destination, int destinationChannels, int numSamples)
+{
+	jassert(numChannels <= destinationChannels);
+
+	if (numChannels == destinationChannels)
+	{
+		switch (numChannels)
+		{
+			case 1: Kernel<1>::interleave(source, destination, 0, numSamples); return;
+			case 6: Kernel<6>::interleave(source, destination, 0, numSamples); return;
+		#if INTERLEAVED_AUDIO_USE_SSE
+			case 2: interleaveStereo(source, destination, numSamples); return;
+			case 4: interleaveQuads<4>(source, destination, numSamples); return;
+			case 8: interleaveQuads<8>(source, destination, numSamples); return;
+		#else
+			case 2: Kernel<2>::interleave(source, destination, 0, numSamples); return;
+			case 4: Kernel<4>::interleave(source, destination, 0, numSamples); return;
+			case 8: Kernel<8>::interleave(source, destination, 0, numSamples); return;
+		#endif
+			default: break;
+		}
+	}
+
+	interleaveScalar(source, numChannels, destination, destinationChannels, numSamples);
+}
+
+/**
+*Splits interleaved frames into planar channels one sample at a time. Used for uncommon channel counts.
+*/
+void InterleavedAudio::deinterleaveScalar(const float* source, int sourceChannels, float* const* destination, int numChannels, int numSamples)
+{
+	for (int channel = 0; channel < numChannels; channel++)
+	{
+		float* channelData = destination[channel];
+
+		for (int sample = 0; sample < numSamples; sample++)
+			channelData[sample] = source[sample * sourceChannels + channel];
+	}
+}
+
+/**
+*Merges planar channels into interleaved frames one sample at a time. Used for uncommon channel counts.
+*/
+void InterleavedAudio::interleaveScalar(const float* const* source, int numChannels, float* destination, int destinationChannels, int numSamples)
+{
+	for (int channel = 0; channel < numChannels; channel++)
+	{
+		const float* channelData = source[channel];
+
+		for (int sample = 0; sample < numSamples; sample++)
+			destination[sample * destinationChannels + channel] = channelData[sample];
+	}
+}
@@ -0,0 +1,27 @@
+/*
+	==============================================================================
+
+	InterleavedAudio
+	by Daniel Rothmann
+
+	Conversion kernels between interleaved frames and planar channels
+
+	==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/**
+* Converts audio between interleaved frames and planar channels.
+* Common channel counts (1, 2, 4, 6 and 8) use kernels specialized at compile time,
+* vectorized with SSE where available. Other channel counts use a scalar loop.
+*/
+namespace InterleavedAudio
+{
+	void deinterleave(const float* source, int sourceChannels, float* const* destination, int numChannels, int numSamples);
+	void interleave(const float* const* source, int numChannels, float* destination, int destinationChannels, int numSamples);
+
+	void deinterleaveScalar(const float* source, int sourceChannels, float* const* destination, int numChannels, int numSamples);
+	void interleaveScalar(const float* const* source, int numChannels, float* destination, int destinationChannels, int numSamples);
+}
@@ -11,6 +11,27 @@
 
 #include "MiniPluginHostApi.h"
 
+// Backs the pointers returned by the string exports. Each thread gets its own copy,
+// so a returned pointer stays valid until the next string export call on the same thread.
+static thread_local String tempString;
+
+/**
+*Copies a string as null-terminated UTF-8 into a caller-owned buffer.
+*@param text The string to copy.
+*@param out The buffer to copy into. If null or too small, nothing is written.
+*@param capacity The number of bytes out can hold.
+*@return The number of bytes needed to hold the string, including the null terminator.
+*/
+static int copyStringToBuffer(const String& text, char* out, int capacity)
+{
+	const int requiredLength = (int) text.getNumBytesAsUTF8() + 1;
+
+	if (out != nullptr && capacity >= requiredLength)
+		text.copyToUTF8(out, (size_t) capacity);
+
+	return requiredLength;
+}
+
 extern "C" {
 	PluginsManager* CreatePluginsManager()
 	{
@@ -22,6 +43,16 @@ extern "C" {
 		delete manager;
 	}
 
+	void SetScannerProcess(PluginsManager* manager, char* executablePath, int numWorkers, int timeoutMilliseconds)
+	{
+		manager->setScannerProcess(executablePath, numWorkers, timeoutMilliseconds);
+	}
+
+	bool RunPluginScanWorker(char* commandLine)
+	{
+		return PluginScanner::runWorker(String(commandLine));
+	}
+
 	bool ScanAndAdd(PluginsManager* manager, char* filePath, bool dontRescanIfAlreadyInList)
 	{
 		return manager->scanAndAdd(filePath, dontRescanIfAlreadyInList);
@@ -52,6 +83,16 @@ extern "C" {
 		manager->clearBlacklist();
 	}
 
+	void SetScanCacheContentHashing(PluginsManager* manager, bool shouldHashContent)
+	{
+		manager->setScanCacheContentHashing(shouldHashContent);
+	}
+
+	void ClearScanCache(PluginsManager* manager)
+	{
+		manager->clearScanCache();
+	}
+
 	void CreateListFromXml(PluginsManager* manager, char* xmlKnownPluginsList)
 	{
 		manager->createListFromXml(xmlKnownPluginsList);
@@ -79,6 +120,59 @@ extern "C" {
 		return pointer;
 	}
 
+	int CreateXmlFromListToBuffer(PluginsManager* manager, char* out, int capacity)
+	{
+		return copyStringToBuffer(manager->createXmlFromList(), out, capacity);
+	}
+
+	int GetXmlPluginDescriptionForFileToBuffer(PluginsManager* manager, char* filePath, char* out, int capacity)
+	{
+		return copyStringToBuffer(manager->getXmlPluginDescriptionForFile(filePath), out, capacity);
+	}
+
+	int GetXmlPluginDescriptionForIdToBuffer(PluginsManager* manager, char* pluginId, char* out, int capacity)
+	{
+		return copyStringToBuffer(manager->getXmlPluginDescriptionForId(pluginId), out, capacity);
+	}
+
+	bool SaveCatalog(PluginsManager* manager, char* path)
+	{
+		return manager->saveCatalog(path);
+	}
+
+	bool OpenCatalog(PluginsManager* manager, char* path)
+	{
+		return manager->openCatalog(path);
+	}
+
+	int QueryPlugins(PluginsManager* manager, const PluginQuery* query, PluginQueryResult* results, int capacity)
+	{
+		if (query == nullptr)
+			return 0;
+
+		return manager->queryPlugins(*query, results, capacity);
+	}
+
+	int GetPluginNameForHandleToBuffer(PluginsManager* manager, int handle, char* out, int capacity)
+	{
+		return copyStringToBuffer(manager->getPluginNameForHandle(handle), out, capacity);
+	}
+
+	int GetXmlPluginDescriptionForHandleToBuffer(PluginsManager* manager, int handle, char* out, int capacity)
+	{
+		return copyStringToBuffer(manager->getXmlPluginDescriptionForHandle(handle), out, capacity);
+	}
+
+	int GetPluginHandleForId(PluginsManager* manager, char* pluginId)
+	{
+		return manager->getHandleForId(pluginId);
+	}
+
+	int GetPluginHandleForFile(PluginsManager* manager, char* filePath)
+	{
+		return manager->getHandleForFile(filePath);
+	}
+
 	PluginHost* CreatePluginHost()
 	{
 		return new PluginHost();
@@ -89,11 +183,37 @@ extern "C" {
 		delete host;
 	}
 
+	void SetHeadless(PluginHost* host, bool shouldBeHeadless)
+	{
+		host->setHeadless(shouldBeHeadless);
+	}
+
 	bool InstantiatePlugin(PluginHost* host, char* xmlPluginDescription, double sampleRate, int bufferSize)
 	{
 		return host->instantiatePlugin(xmlPluginDescription, sampleRate, bufferSize);
 	}
 
+	bool InstantiatePluginByHandle(PluginHost* host, PluginsManager* manager, int handle, double sampleRate, int bufferSize)
+	{
+		auto* description = manager->getDescriptionForHandle(handle);
+		return description != nullptr && host->instantiatePlugin(*description, sampleRate, bufferSize);
+	}
+
+	bool InstantiatePluginAsync(PluginHost* host, char* xmlPluginDescription, double sampleRate, int bufferSize, InstantiationCallback callback)
+	{
+		return host->instantiatePluginAsync(xmlPluginDescription, sampleRate, bufferSize, callback);
+	}
+
+	int GetInstantiationState(PluginHost* host)
+	{
+		return host->getInstantiationState();
+	}
+
+	bool CreateEditor(PluginHost* host)
+	{
+		return host->createEditor();
+	}
+
 	void PrepareToPlay(PluginHost* host, double sampleRate, int expectedSamplesPerBlock)
 	{
 		host->prepareToPlay(sampleRate, expectedSamplesPerBlock);
@@ -104,16 +224,104 @@ extern "C" {
 		return host->suspendPlugin(shouldBeSuspended);
 	}
 
+	bool SetNonRealtime(PluginHost* host, bool isNonRealtime)
+	{
+		return host->setNonRealtime(isNonRealtime);
+	}
+
+	bool ResetPlugin(PluginHost* host)
+	{
+		return host->resetPlugin();
+	}
+
 	bool ReleasePlugin(PluginHost* host)
 	{
 		return host->releasePlugin();
 	}
 
+	int GetStateSize(PluginHost* host, bool currentProgramOnly)
+	{
+		return host->getStateSize(currentProgramOnly);
+	}
+
+	int GetState(PluginHost* host, void* out, int capacity, bool currentProgramOnly)
+	{
+		return host->getState(out, capacity, currentProgramOnly);
+	}
+
+	bool SetState(PluginHost* host, const void* data, int size, bool currentProgramOnly)
+	{
+		return host->setState(data, size, currentProgramOnly);
+	}
+
+	int AddPresetToBank(PluginHost* host, const void* data, int size, bool currentProgramOnly)
+	{
+		return host->addPresetToBank(data, size, currentProgramOnly);
+	}
+
+	void ClearPresetBank(PluginHost* host)
+	{
+		host->clearPresetBank();
+	}
+
+	int GetNumBankPresets(PluginHost* host)
+	{
+		return host->getNumBankPresets();
+	}
+
+	bool SwitchToPreset(PluginHost* host, int index, int crossfadeSamples)
+	{
+		return host->switchToPreset(index, crossfadeSamples);
+	}
+
+	bool IsSwitchingPreset(PluginHost* host)
+	{
+		return host->isSwitchingPreset();
+	}
+
 	void ProcessBlock(PluginHost* host, float* buffer, int bufferSize, int numChannels)
 	{
 		host->processBlock(buffer, bufferSize, numChannels);
 	}
 
+	void ProcessBlockPlanar(PluginHost* host, float** channels, int numChannels, int numSamples)
+	{
+		host->processBlockPlanar(channels, numChannels, numSamples);
+	}
+
+	void ProcessBlockInterleaved(PluginHost* host, float* buffer, int numFrames, int numChannels)
+	{
+		host->processBlockInterleaved(buffer, numFrames, numChannels);
+	}
+
+	void ProcessBlockDouble(PluginHost* host, double** channels, int numChannels, int numSamples)
+	{
+		host->processBlockDouble(channels, numChannels, numSamples);
+	}
+
+	int ProcessBlockWithMidi(PluginHost* host, float** channels, int numChannels, int numSamples, const PackedMidiEvent* events, int numEvents,
+							 const uint8* sysExData, int sysExSize, PackedMidiEvent* outputEvents, int outputCapacity,
+							 uint8* outputSysExData, int outputSysExCapacity)
+	{
+		return host->processBlockWithMidi(channels, numChannels, numSamples, events, numEvents, sysExData, sysExSize,
+										  outputEvents, outputCapacity, outputSysExData, outputSysExCapacity);
+	}
+
+	bool SetDoublePrecision(PluginHost* host, bool shouldUseDoublePrecision)
+	{
+		return host->setDoublePrecision(shouldUseDoublePrecision);
+	}
+
+	bool SetReblocking(PluginHost* host, bool shouldReblock, int pluginBlockSize)
+	{
+		return host->setReblocking(shouldReblock, pluginBlockSize);
+	}
+
+	int GetHostLatencySamples(PluginHost* host)
+	{
+		return host->getHostLatencySamples();
+	}
+
 	int GetNumInputs(PluginHost* host)
 	{
 		return host->getNumInputs();
@@ -124,6 +332,11 @@ extern "C" {
 		return host->getNumOutputs();
 	}
 
+	int GetLatencySamples(PluginHost* host)
+	{
+		return host->getLatencySamples();
+	}
+
 	int GetNumParameters(PluginHost* host)
 	{
 		return host->getNumParameters();
@@ -141,6 +354,16 @@ extern "C" {
 		return pointer;
 	}
 
+	int GetParameterNameToBuffer(PluginHost* host, int index, char* out, int capacity)
+	{
+		return copyStringToBuffer(host->getParameterName(index), out, capacity);
+	}
+
+	int GetParameterIndex(PluginHost* host, char* name)
+	{
+		return host->getParameterIndex(name);
+	}
+
 	float GetValueByName(PluginHost* host, char* name)
 	{
 		return host->getValueByName(name);
@@ -161,4 +384,234 @@ extern "C" {
 		return host->setValueByIndex(index, value);
 	}
 
+	int GetValuesByIndex(PluginHost* host, const int* indices, float* values, int count)
+	{
+		return host->getValuesByIndex(indices, values, count);
+	}
+
+	int SetValuesByIndex(PluginHost* host, const int* indices, const float* values, int count)
+	{
+		return host->setValuesByIndex(indices, values, count);
+	}
+
+	int GetAllValues(PluginHost* host, float* values, int capacity)
+	{
+		return host->getAllValues(values, capacity);
+	}
+
+	bool ScheduleValueByIndex(PluginHost* host, int index, float value, int sampleOffset)
+	{
+		return host->scheduleValueByIndex(index, value, sampleOffset);
+	}
+
+	int GetParameterInfoTable(PluginHost* host, ParameterInfo* infos, int capacity, char* strings, int stringCapacity, int* requiredStringSize)
+	{
+		return host->getParameterInfoTable(infos, capacity, strings, stringCapacity, requiredStringSize);
+	}
+
+	PluginChain* CreatePluginChain(double sampleRate, int bufferSize)
+	{
+		return new PluginChain(sampleRate, bufferSize);
+	}
+
+	void DeletePluginChain(PluginChain* chain)
+	{
+		delete chain;
+	}
+
+	int InsertPluginInChain(PluginChain* chain, char* xmlPluginDescription, int insertIndex)
+	{
+		return chain->insertPlugin(xmlPluginDescription, insertIndex);
+	}
+
+	bool RemovePluginFromChain(PluginChain* chain, int index)
+	{
+		return chain->removePlugin(index);
+	}
+
+	bool MovePluginInChain(PluginChain* chain, int currentIndex, int newIndex)
+	{
+		return chain->movePlugin(currentIndex, newIndex);
+	}
+
+	int GetNumPluginsInChain(PluginChain* chain)
+	{
+		return chain->getNumPlugins();
+	}
+
+	PluginHost* GetPluginInChain(PluginChain* chain, int index)
+	{
+		return chain->getPlugin(index);
+	}
+
+	void PrepareChain(PluginChain* chain, double sampleRate, int expectedSamplesPerBlock)
+	{
+		chain->prepareToPlay(sampleRate, expectedSamplesPerBlock);
+	}
+
+	void ProcessChainBlock(PluginChain* chain, float** channels, int numChannels, int numSamples)
+	{
+		chain->processBlock(channels, numChannels, numSamples);
+	}
+
+	int GetChainLatencySamples(PluginChain* chain)
+	{
+		return chain->getLatencySamples();
+	}
+
+	PluginGraph* CreatePluginGraph(double sampleRate, int bufferSize, int numWorkers)
+	{
+		return new PluginGraph(sampleRate, bufferSize, numWorkers);
+	}
+
+	void DeletePluginGraph(PluginGraph* graph)
+	{
+		delete graph;
+	}
+
+	int AddNodeToGraph(PluginGraph* graph, char* xmlPluginDescription)
+	{
+		return graph->addNode(xmlPluginDescription);
+	}
+
+	bool ConnectGraphNodes(PluginGraph* graph, int sourceNode, int destinationNode)
+	{
+		return graph->connectNodes(sourceNode, destinationNode);
+	}
+
+	bool DisconnectGraphNodes(PluginGraph* graph, int sourceNode, int destinationNode)
+	{
+		return graph->disconnectNodes(sourceNode, destinationNode);
+	}
+
+	int GetNumGraphNodes(PluginGraph* graph)
+	{
+		return graph->getNumNodes();
+	}
+
+	PluginHost* GetGraphNode(PluginGraph* graph, int node)
+	{
+		return graph->getNode(node);
+	}
+
+	void PrepareGraph(PluginGraph* graph, double sampleRate, int expectedSamplesPerBlock)
+	{
+		graph->prepareToPlay(sampleRate, expectedSamplesPerBlock);
+	}
+
+	void ProcessGraphBlock(PluginGraph* graph, float** channels, int numChannels, int numSamples)
+	{
+		graph->processBlock(channels, numChannels, numSamples);
+	}
+
+	PluginHostPool* CreatePluginHostPool(int numShards, bool pinThreadsToCores)
+	{
+		return new PluginHostPool(numShards, pinThreadsToCores);
+	}
+
+	void DeletePluginHostPool(PluginHostPool* pool)
+	{
+		delete pool;
+	}
+
+	bool InstantiatePoolPlugins(PluginHostPool* pool, char* xmlPluginDescription, int numInstances, double sampleRate, int bufferSize)
+	{
+		return pool->instantiatePlugins(xmlPluginDescription, numInstances, sampleRate, bufferSize);
+	}
+
+	void ReleasePoolPlugins(PluginHostPool* pool)
+	{
+		pool->releasePlugins();
+	}
+
+	void PreparePool(PluginHostPool* pool, double sampleRate, int expectedSamplesPerBlock)
+	{
+		pool->prepareToPlay(sampleRate, expectedSamplesPerBlock);
+	}
+
+	void ProcessPoolBlock(PluginHostPool* pool, float** streamChannels, int numChannels, int numSamples)
+	{
+		pool->processBlock(streamChannels, numChannels, numSamples);
+	}
+
+	int GetNumPoolInstances(PluginHostPool* pool)
+	{
+		return pool->getNumInstances();
+	}
+
+	PluginHost* GetPoolInstance(PluginHostPool* pool, int index)
+	{
+		return pool->getInstance(index);
+	}
+
+	int GetNumPoolShards(PluginHostPool* pool)
+	{
+		return pool->getNumShards();
+	}
+
+	double GetPoolShardProcessingTime(PluginHostPool* pool, int shard)
+	{
+		return pool->getShardProcessingTime(shard);
+	}
+
+	PluginInstanceCache* CreateInstanceCache(int idleInstancesPerPreset)
+	{
+		return new PluginInstanceCache(idleInstancesPerPreset);
+	}
+
+	void DeleteInstanceCache(PluginInstanceCache* cache)
+	{
+		delete cache;
+	}
+
+	int AddCachePreset(PluginInstanceCache* cache, char* xmlPluginDescription, const void* stateData, int stateSize, double sampleRate, int bufferSize)
+	{
+		return cache->addPreset(xmlPluginDescription, stateData, stateSize, sampleRate, bufferSize);
+	}
+
+	PluginHost* CheckoutCachedInstance(PluginInstanceCache* cache, int presetId)
+	{
+		return cache->checkout(presetId);
+	}
+
+	bool CheckinCachedInstance(PluginInstanceCache* cache, PluginHost* host)
+	{
+		return cache->checkin(host);
+	}
+
+	int GetNumIdleCachedInstances(PluginInstanceCache* cache, int presetId)
+	{
+		return cache->getNumIdleInstances(presetId);
+	}
+
+	void ClearInstanceCache(PluginInstanceCache* cache)
+	{
+		cache->clear();
+	}
+
+	bool RenderFile(PluginHost* host, char* inputPath, char* outputPath, int blockSize)
+	{
+		OfflineRenderer renderer(blockSize);
+		return renderer.renderFile(*host, File(String(inputPath)), File(String(outputPath)));
+	}
+
+	bool RenderFileWithChain(PluginChain* chain, char* inputPath, char* outputPath, int blockSize)
+	{
+		OfflineRenderer renderer(blockSize);
+		return renderer.renderFile(*chain, File(String(inputPath)), File(String(outputPath)));
+	}
+
+	bool RenderBatch(char* xmlPluginDescription, char* inputDirectoryOrManifest, char* outputDirectory, int numWorkers, int blockSize,
+					 BatchFileCallback callback, BatchReport* report)
+	{
+		const Array<File> inputFiles = BatchRenderer::findInputFiles(File(String(inputDirectoryOrManifest)));
+		BatchRenderer renderer(numWorkers, blockSize);
+		const BatchReport batchReport = renderer.renderBatch(xmlPluginDescription, inputFiles, File(String(outputDirectory)), callback);
+
+		if (report != nullptr)
+			*report = batchReport;
+
+		return batchReport.numFilesFailed == 0;
+	}
+
 }
\ No newline at end of file
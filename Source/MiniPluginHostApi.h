@@ -12,6 +12,12 @@
 #pragma once
 #include "PluginsManager.h"
 #include "PluginHost.h"
+#include "PluginChain.h"
+#include "PluginGraph.h"
+#include "PluginHostPool.h"
+#include "PluginInstanceCache.h"
+#include "OfflineRenderer.h"
+#include "BatchRenderer.h"
 
 #define HOST_API __declspec(dllexport)
 
@@ -19,34 +25,131 @@ extern "C" {
 	// Exposed methods related to plugins manager
 	HOST_API PluginsManager* CreatePluginsManager();
 	HOST_API void DeletePluginsManager(PluginsManager* manager);
+	HOST_API void SetScannerProcess(PluginsManager* manager, char* executablePath, int numWorkers, int timeoutMilliseconds);
+	// Called by the main of the scan worker executable with its command line; see the README for how to build it.
+	HOST_API bool RunPluginScanWorker(char* commandLine);
 	HOST_API bool ScanAndAdd(PluginsManager* manager, char* filePath, bool dontRescanIfAlreadyInList);
 	HOST_API bool ScanDirectory(PluginsManager* manager, char* path, bool dontRescanIfAlreadyInList, bool searchRecursive);
 	HOST_API void RescanAll(PluginsManager* manager);
 	HOST_API void AddToBlacklist(PluginsManager* manager, char* pluginId);
 	HOST_API void RemoveFromBlacklist(PluginsManager* manager, char* pluginId);
 	HOST_API void ClearBlacklist(PluginsManager* manager);
+	HOST_API void SetScanCacheContentHashing(PluginsManager* manager, bool shouldHashContent);
+	HOST_API void ClearScanCache(PluginsManager* manager);
 	HOST_API void CreateListFromXml(PluginsManager* manager, char* xmlKnownPluginsList);
 	HOST_API const char* CreateXmlFromList(PluginsManager* manager);
 	HOST_API const char* GetXmlPluginDescriptionForFile(PluginsManager* manager, char* filePath);
 	HOST_API const char* GetXmlPluginDescriptionForId(PluginsManager* manager, char* pluginId);
+	HOST_API int CreateXmlFromListToBuffer(PluginsManager* manager, char* out, int capacity);
+	HOST_API int GetXmlPluginDescriptionForFileToBuffer(PluginsManager* manager, char* filePath, char* out, int capacity);
+	HOST_API int GetXmlPluginDescriptionForIdToBuffer(PluginsManager* manager, char* pluginId, char* out, int capacity);
+	HOST_API bool SaveCatalog(PluginsManager* manager, char* path);
+	HOST_API bool OpenCatalog(PluginsManager* manager, char* path);
+	HOST_API int QueryPlugins(PluginsManager* manager, const PluginQuery* query, PluginQueryResult* results, int capacity);
+	HOST_API int GetPluginNameForHandleToBuffer(PluginsManager* manager, int handle, char* out, int capacity);
+	HOST_API int GetXmlPluginDescriptionForHandleToBuffer(PluginsManager* manager, int handle, char* out, int capacity);
+	HOST_API int GetPluginHandleForId(PluginsManager* manager, char* pluginId);
+	HOST_API int GetPluginHandleForFile(PluginsManager* manager, char* filePath);
 
 	// Exposed methods related to plugin host
 	HOST_API PluginHost* CreatePluginHost();
 	HOST_API void DeletePluginHost(PluginHost* host);
+	HOST_API void SetHeadless(PluginHost* host, bool shouldBeHeadless);
 	HOST_API bool InstantiatePlugin(PluginHost* host, char* xmlPluginDescription, double sampleRate, int bufferSize);
+	HOST_API bool InstantiatePluginByHandle(PluginHost* host, PluginsManager* manager, int handle, double sampleRate, int bufferSize);
+	HOST_API bool InstantiatePluginAsync(PluginHost* host, char* xmlPluginDescription, double sampleRate, int bufferSize, InstantiationCallback callback);
+	HOST_API int GetInstantiationState(PluginHost* host);
+	HOST_API bool CreateEditor(PluginHost* host);
 	HOST_API void PrepareToPlay(PluginHost* host, double sampleRate, int expectedSamplesPerBlock);
 	HOST_API bool SuspendPlugin(PluginHost* host, bool shouldBeSuspended);
+	HOST_API bool SetNonRealtime(PluginHost* host, bool isNonRealtime);
+	HOST_API bool ResetPlugin(PluginHost* host);
 	HOST_API bool ReleasePlugin(PluginHost* host);
+	HOST_API int GetStateSize(PluginHost* host, bool currentProgramOnly);
+	HOST_API int GetState(PluginHost* host, void* out, int capacity, bool currentProgramOnly);
+	HOST_API bool SetState(PluginHost* host, const void* data, int size, bool currentProgramOnly);
+	HOST_API int AddPresetToBank(PluginHost* host, const void* data, int size, bool currentProgramOnly);
+	HOST_API void ClearPresetBank(PluginHost* host);
+	HOST_API int GetNumBankPresets(PluginHost* host);
+	HOST_API bool SwitchToPreset(PluginHost* host, int index, int crossfadeSamples);
+	HOST_API bool IsSwitchingPreset(PluginHost* host);
 	HOST_API void ProcessBlock(PluginHost* host, float* buffer, int bufferSize, int numChannels);
+	HOST_API void ProcessBlockPlanar(PluginHost* host, float** channels, int numChannels, int numSamples);
+	HOST_API void ProcessBlockInterleaved(PluginHost* host, float* buffer, int numFrames, int numChannels);
+	HOST_API void ProcessBlockDouble(PluginHost* host, double** channels, int numChannels, int numSamples);
+	HOST_API int ProcessBlockWithMidi(PluginHost* host, float** channels, int numChannels, int numSamples, const PackedMidiEvent* events, int numEvents,
+									  const uint8* sysExData, int sysExSize, PackedMidiEvent* outputEvents, int outputCapacity,
+									  uint8* outputSysExData, int outputSysExCapacity);
+	HOST_API bool SetDoublePrecision(PluginHost* host, bool shouldUseDoublePrecision);
+	HOST_API bool SetReblocking(PluginHost* host, bool shouldReblock, int pluginBlockSize);
+	HOST_API int GetHostLatencySamples(PluginHost* host);
 	HOST_API int GetNumInputs(PluginHost* host);
 	HOST_API int GetNumOutputs(PluginHost* host);
+	HOST_API int GetLatencySamples(PluginHost* host);
 	HOST_API int GetNumParameters(PluginHost* host);
 	HOST_API int GetNumNamedParameters(PluginHost* host);
 	HOST_API const char* GetParameterName(PluginHost* host, int index);
+	HOST_API int GetParameterNameToBuffer(PluginHost* host, int index, char* out, int capacity);
+	HOST_API int GetParameterIndex(PluginHost* host, char* name);
 	HOST_API float GetValueByName(PluginHost* host, char* name);
 	HOST_API bool SetValueByName(PluginHost* host, char* name, float value);
 	HOST_API float GetValueByIndex(PluginHost* host, int index);
 	HOST_API bool SetValueByIndex(PluginHost* host, int index, float value);
-}
+	HOST_API int GetValuesByIndex(PluginHost* host, const int* indices, float* values, int count);
+	HOST_API int SetValuesByIndex(PluginHost* host, const int* indices, const float* values, int count);
+	HOST_API int GetAllValues(PluginHost* host, float* values, int capacity);
+	HOST_API bool ScheduleValueByIndex(PluginHost* host, int index, float value, int sampleOffset);
+	HOST_API int GetParameterInfoTable(PluginHost* host, ParameterInfo* infos, int capacity, char* strings, int stringCapacity, int* requiredStringSize);
 
-String tempString;
\ No newline at end of file
+	// Exposed methods related to plugin chain
+	HOST_API PluginChain* CreatePluginChain(double sampleRate, int bufferSize);
+	HOST_API void DeletePluginChain(PluginChain* chain);
+	HOST_API int InsertPluginInChain(PluginChain* chain, char* xmlPluginDescription, int insertIndex);
+	HOST_API bool RemovePluginFromChain(PluginChain* chain, int index);
+	HOST_API bool MovePluginInChain(PluginChain* chain, int currentIndex, int newIndex);
+	HOST_API int GetNumPluginsInChain(PluginChain* chain);
+	// The host stays owned by the chain and is deleted by RemovePluginFromChain or DeletePluginChain, so callers must not
+	// keep it across either call, nor use it while another thread may make one.
+	HOST_API PluginHost* GetPluginInChain(PluginChain* chain, int index);
+	HOST_API void PrepareChain(PluginChain* chain, double sampleRate, int expectedSamplesPerBlock);
+	HOST_API void ProcessChainBlock(PluginChain* chain, float** channels, int numChannels, int numSamples);
+	HOST_API int GetChainLatencySamples(PluginChain* chain);
+
+	// Exposed methods related to plugin graph
+	HOST_API PluginGraph* CreatePluginGraph(double sampleRate, int bufferSize, int numWorkers);
+	HOST_API void DeletePluginGraph(PluginGraph* graph);
+	HOST_API int AddNodeToGraph(PluginGraph* graph, char* xmlPluginDescription);
+	HOST_API bool ConnectGraphNodes(PluginGraph* graph, int sourceNode, int destinationNode);
+	HOST_API bool DisconnectGraphNodes(PluginGraph* graph, int sourceNode, int destinationNode);
+	HOST_API int GetNumGraphNodes(PluginGraph* graph);
+	HOST_API PluginHost* GetGraphNode(PluginGraph* graph, int node);
+	HOST_API void PrepareGraph(PluginGraph* graph, double sampleRate, int expectedSamplesPerBlock);
+	HOST_API void ProcessGraphBlock(PluginGraph* graph, float** channels, int numChannels, int numSamples);
+
+	// Exposed methods related to plugin host pool
+	HOST_API PluginHostPool* CreatePluginHostPool(int numShards, bool pinThreadsToCores);
+	HOST_API void DeletePluginHostPool(PluginHostPool* pool);
+	HOST_API bool InstantiatePoolPlugins(PluginHostPool* pool, char* xmlPluginDescription, int numInstances, double sampleRate, int bufferSize);
+	HOST_API void ReleasePoolPlugins(PluginHostPool* pool);
+	HOST_API void PreparePool(PluginHostPool* pool, double sampleRate, int expectedSamplesPerBlock);
+	HOST_API void ProcessPoolBlock(PluginHostPool* pool, float** streamChannels, int numChannels, int numSamples);
+	HOST_API int GetNumPoolInstances(PluginHostPool* pool);
+	HOST_API PluginHost* GetPoolInstance(PluginHostPool* pool, int index);
+	HOST_API int GetNumPoolShards(PluginHostPool* pool);
+	HOST_API double GetPoolShardProcessingTime(PluginHostPool* pool, int shard);
+
+	// Exposed methods related to plugin instance cache
+	HOST_API PluginInstanceCache* CreateInstanceCache(int idleInstancesPerPreset);
+	HOST_API void DeleteInstanceCache(PluginInstanceCache* cache);
+	HOST_API int AddCachePreset(PluginInstanceCache* cache, char* xmlPluginDescription, const void* stateData, int stateSize, double sampleRate, int bufferSize);
+	HOST_API PluginHost* CheckoutCachedInstance(PluginInstanceCache* cache, int presetId);
+	HOST_API bool CheckinCachedInstance(PluginInstanceCache* cache, PluginHost* host);
+	HOST_API int GetNumIdleCachedInstances(PluginInstanceCache* cache, int presetId);
+	HOST_API void ClearInstanceCache(PluginInstanceCache* cache);
+
+	// Exposed methods related to offline rendering
+	HOST_API bool RenderFile(PluginHost* host, char* inputPath, char* outputPath, int blockSize);
+	HOST_API bool RenderFileWithChain(PluginChain* chain, char* inputPath, char* outputPath, int blockSize);
+	HOST_API bool RenderBatch(char* xmlPluginDescription, char* inputDirectoryOrManifest, char* outputDirectory, int numWorkers, int blockSize,
+							  BatchFileCallback callback, BatchReport* report);
+}
\ No newline at end of file
@@ -0,0 +1,314 @@
+/*
+	==============================================================================
+
+	OfflineRenderer
+	by Daniel Rothmann
+
+	Renders audio files through a plugin host or chain with overlapped reading, processing and writing
+
+	==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+
+namespace
+{
+	const int numBlocksInFlight = 8;
+
+	/**
+	* A bounded single-producer single-consumer queue of block indices. Popping waits until a block is available.
+	*/
+	class BlockQueue
+	{
+	public:
+		BlockQueue(int capacity) : fifo(capacity + 1)
+		{
+			blocks.allocate((size_t) (capacity + 1), true);
+		}
+
+		void push(int block)
+		{
+			int start1, size1, start2, size2;
+			fifo.prepareToWrite(1, start1, size1, start2, size2);
+			jassert(size1 + size2 == 1);
+
+			blocks[size1 > 0 ? start1 : start2] = block;
+			fifo.finishedWrite(1);
+			blockAdded.signal();
+		}
+
+		int pop()
+		{
+			for (;;)
+			{
+				int start1, size1, start2, size2;
+				fifo.prepareToRead(1, start1, size1, start2, size2);
+
+				if (size1 + size2 == 1)
+				{
+					const int block = blocks[size1 > 0 ? start1 : start2];
+					fifo.finishedRead(1);
+					return block;
+				}
+
+				blockAdded.wait(1);
+			}
+		}
+
+	private:
+		AbstractFifo fifo;
+		HeapBlock<int> blocks;
+		WaitableEvent blockAdded;
+	};
+
+	/**
+	* A thread running a single pipeline stage.
+	*/
+	class StageThread : public Thread
+	{
+	public:
+		StageThread(const String& name, std::function<void()> stageFunction)
+			: Thread(name), stage(stageFunction)
+		{
+		}
+
+		void run() override
+		{
+			stage();
+		}
+
+	private:
+		std::function<void()> stage;
+	};
+}
+
+/**
+*Constructs a renderer.
+*@param renderBlockSize The number of samples processed at once. Larger blocks render faster.
+*/
+OfflineRenderer::OfflineRenderer(int renderBlockSize)
+	: blockSize(jmax(1, renderBlockSize))
+{
+	formatManager.registerBasicFormats();
+}
+
+OfflineRenderer::~OfflineRenderer()
+{
+}
+
+/**
+*Renders an audio file through a plugin host. The host is prepared again at the sample rate of the file.
+*@param host The host whose plugin should process the file.
+*@param inputFile The audio file to read.
+*@param outputFile The audio file to write. Its format is chosen from the file extension, and any existing file is replaced.
+*@return Wether the file was rendered. Returns false if reading or writing failed part way, and no output file is left behind then.
+*/
+bool OfflineRenderer::renderFile(PluginHost& host, const File& inputFile, const File& outputFile)
+{
+	host.setNonRealtime(true);
+
+	const bool rendered = render(inputFile, outputFile,
+		[&](double rate) { host.prepareToPlay(rate, blockSize); },
+		[&](float** channels, int numChannels, int numSamples) { host.processBlockPlanar(channels, numChannels, numSamples); },
+		[&]() { return host.getLatencySamples() + host.getHostLatencySamples(); });
+
+	host.setNonRealtime(false);
+	return rendered;
+}
+
+/**
+*Renders an audio file through every plugin in a chain. The chain is prepared again at the sample rate of the file.
+*@param chain The chain which should process the file.
+*@param inputFile The audio file to read.
+*@param outputFile The audio file to write. Its format is chosen from the file extension, and any existing file is replaced.
+*@return Wether the file was rendered. Returns false if reading or writing failed part way, and no output file is left behind then.
+*/
+bool OfflineRenderer::renderFile(PluginChain& chain, const File& inputFile, const File& outputFile)
+{
+	chain.setNonRealtime(true);
+
+	const bool rendered = render(inputFile, outputFile,
+		[&](double rate) { chain.prepareToPlay(rate, blockSize); },
+		[&](float** channels, int numChannels, int numSamples) { chain.processBlock(channels, numChannels, numSamples); },
+		[&]() { return chain.getLatencySamples(); });
+
+	chain.setNonRealtime(false);
+	return rendered;
+}
+
+/**
+*Gets the number of samples per channel written by the last render.
+*@return The number of samples rendered.
+*/
+int64 OfflineRenderer::getNumSamplesRendered() const
+{
+	return numSamplesRendered;
+}
+
+/**
+*Gets the sample rate of the file read by the last render.
+*@return The sample rate.
+*/
+double OfflineRenderer::getSampleRate() const
+{
+	return sampleRate;
+}
+
+/**
+*Runs the read, process and write stages. The calling thread processes while two helper threads read and write.
+*Input past the end of the file is padded with silence for as long as the latency, and the first latency samples of output are dropped.
+*/
+bool OfflineRenderer::render(const File& inputFile, const File& outputFile, const PrepareFunction& prepare,
+							 const ProcessFunction& process, const std::function<int()>& getLatency)
+{
+	numSamplesRendered = 0;
+
+	ScopedPointer<AudioFormatReader> reader = createReader(inputFile);
+	AudioFormat* outputFormat = formatManager.findFormatForFileExtension(outputFile.getFileExtension());
+
+	if (reader == nullptr || outputFormat == nullptr || reader->numChannels < 1)
+		return false;
+
+	sampleRate = reader->sampleRate;
+	const int numChannels = (int) reader->numChannels;
+	const int64 inputLength = reader->lengthInSamples;
+
+	outputFile.deleteFile();
+	ScopedPointer<FileOutputStream> outputStream = outputFile.createOutputStream();
+
+	if (outputStream == nullptr)
+		return false;
+
+	const int bitsPerSample = outputFormat->getPossibleBitDepths().contains((int) reader->bitsPerSample) ? (int) reader->bitsPerSample : 24;
+	ScopedPointer<AudioFormatWriter> writer = outputFormat->createWriterFor(outputStream, sampleRate, (unsigned int) numChannels,
+																			 bitsPerSample, reader->metadataValues, 0);
+
+	if (writer == nullptr)
+		return false;
+
+	// The writer owns the stream now.
+	outputStream.release();
+
+	prepare(sampleRate);
+	const int latency = jmax(0, getLatency());
+
+	OwnedArray<AudioBuffer<float>> blocks;
+	HeapBlock<int> blockLengths;
+	blockLengths.allocate((size_t) numBlocksInFlight, true);
+	BlockQueue freeBlocks(numBlocksInFlight), readBlocks(numBlocksInFlight), processedBlocks(numBlocksInFlight);
+
+	for (int block = 0; block < numBlocksInFlight; block++)
+	{
+		blocks.add(new AudioBuffer<float>(numChannels, blockSize));
+		freeBlocks.push(block);
+	}
+
+	// Each flag is only written by its stage and read once the stage has exited.
+	bool readFailed = false;
+	bool writeFailed = false;
+
+	// A block of length 0 marks the end of the stream.
+	StageThread readStage("OfflineRenderer reader", [&]()
+	{
+		const int64 totalLength = inputLength + latency;
+
+		for (int64 position = 0;; position += blockSize)
+		{
+			const int block = freeBlocks.pop();
+			const int length = (int) jmin((int64) blockSize, jmax((int64) 0, totalLength - position));
+			const int lengthFromFile = (int) jmin((int64) length, jmax((int64) 0, inputLength - position));
+
+			if (lengthFromFile > 0 && !reader->read(blocks[block], 0, lengthFromFile, position, true, true))
+				readFailed = true;
+
+			if (lengthFromFile < length)
+				blocks[block]->clear(lengthFromFile, length - lengthFromFile);
+
+			blockLengths[block] = length;
+			readBlocks.push(block);
+
+			if (length == 0)
+				break;
+		}
+	});
+
+	StageThread writeStage("OfflineRenderer writer", [&]()
+	{
+		int64 samplesToSkip = latency;
+
+		for (;;)
+		{
+			const int block = processedBlocks.pop();
+			const int length = blockLengths[block];
+
+			if (length == 0)
+				break;
+
+			const int skip = (int) jmin((int64) length, samplesToSkip);
+			samplesToSkip -= skip;
+
+			// After a failed write the remaining blocks are still drained, so the other stages can finish.
+			if (length > skip && !writeFailed)
+			{
+				if (writer->writeFromAudioSampleBuffer(*blocks[block], skip, length - skip))
+					numSamplesRendered += length - skip;
+				else
+					writeFailed = true;
+			}
+
+			freeBlocks.push(block);
+		}
+	});
+
+	readStage.startThread();
+	writeStage.startThread();
+
+	for (;;)
+	{
+		const int block = readBlocks.pop();
+		const int length = blockLengths[block];
+
+		if (length > 0)
+			process(blocks[block]->getArrayOfWritePointers(), numChannels, length);
+
+		processedBlocks.push(block);
+
+		if (length == 0)
+			break;
+	}
+
+	readStage.waitForThreadToExit(-1);
+	writeStage.waitForThreadToExit(-1);
+
+	if (!writeFailed && !writer->flush())
+		writeFailed = true;
+
+	writer = nullptr;
+
+	// Don't leave a truncated file behind which looks like a finished render.
+	if (readFailed || writeFailed)
+	{
+		outputFile.deleteFile();
+		return false;
+	}
+
+	return true;
+}
+
+/**
+*Opens an audio file for reading, memory-mapping it when the format supports it.
+*@param file The audio file to open.
+*@return A reader for the file. If the file can't be read, nullptr is returned.
+*/
+AudioFormatReader* OfflineRenderer::createReader(const File& file)
+{
+	if (AudioFormat* format = formatManager.findFormatForFileExtension(file.getFileExtension()))
+	{
+		ScopedPointer<MemoryMappedAudioFormatReader> mappedReader = format->createMemoryMappedReader(file);
+
+		if (mappedReader != nullptr && mappedReader->mapEntireFile())
+			return mappedReader.release();
+	}
+
+	return formatManager.createReaderFor(file);
+}
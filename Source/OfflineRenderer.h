@@ -0,0 +1,48 @@
+/*
+	==============================================================================
+
+	OfflineRenderer
+	by Daniel Rothmann
+
+	Renders audio files through a plugin host or chain with overlapped reading, processing and writing
+
+	==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PluginHost.h"
+#include "PluginChain.h"
+#include <functional>
+
+/**
+* Renders audio files through a plugin host or chain as fast as possible. Reading, processing and writing
+* run on separate threads, handing blocks to each other through bounded lock-free queues.
+* WAV and AIFF input is read through memory-mapped readers. Plugin latency is compensated, so the output
+* lines up with the input and has the same length and channel count.
+*/
+class OfflineRenderer
+{
+public:
+	OfflineRenderer(int blockSize);
+	~OfflineRenderer();
+
+	bool renderFile(PluginHost& host, const File& inputFile, const File& outputFile);
+	bool renderFile(PluginChain& chain, const File& inputFile, const File& outputFile);
+
+	int64 getNumSamplesRendered() const;
+	double getSampleRate() const;
+
+private:
+	typedef std::function<void(double sampleRate)> PrepareFunction;
+	typedef std::function<void(float** channels, int numChannels, int numSamples)> ProcessFunction;
+
+	bool render(const File& inputFile, const File& outputFile, const PrepareFunction& prepare,
+				const ProcessFunction& process, const std::function<int()>& getLatency);
+	AudioFormatReader* createReader(const File& file);
+
+	AudioFormatManager formatManager;
+	const int blockSize;
+	int64 numSamplesRendered = 0;
+	double sampleRate = 0.0;
+};
@@ -0,0 +1,85 @@
+/*
+	==============================================================================
+
+	ParameterEventQueue
+	by Daniel Rothmann
+
+	A lock-free queue of timestamped parameter changes for the audio thread
+
+	==============================================================================
+*/
+
+#include "ParameterEventQueue.h"
+
+/**
+*Constructs a queue which can hold a fixed number of events.
+*@param capacity The maximum number of events waiting in the queue.
+*/
+ParameterEventQueue::ParameterEventQueue(int capacity)
+	: fifo(capacity + 1)
+{
+	// AbstractFifo keeps one slot free to tell a full buffer from an empty one.
+	events.allocate((size_t) (capacity + 1), true);
+}
+
+ParameterEventQueue::~ParameterEventQueue()
+{
+}
+
+/**
+*Adds an event to the queue. Safe to call from several threads at once.
+*@param event The event to add.
+*@return Wether the event was added. If the queue is full, false is returned.
+*/
+bool ParameterEventQueue::push(const ParameterEvent& event)
+{
+	const SpinLock::ScopedLockType lock(writeLock);
+
+	int start1, size1, start2, size2;
+	fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+	if (size1 + size2 < 1)
+		return false;
+
+	events[size1 > 0 ? start1 : start2] = event;
+	fifo.finishedWrite(1);
+	return true;
+}
+
+/**
+*Removes events from the queue in the order they were pushed. Must only be called from one thread, normally the audio thread.
+*@param destination An array receiving the events.
+*@param maxEvents The number of events destination can hold.
+*@return The number of events removed.
+*/
+int ParameterEventQueue::pop(ParameterEvent* destination, int maxEvents)
+{
+	int start1, size1, start2, size2;
+	fifo.prepareToRead(maxEvents, start1, size1, start2, size2);
+
+	for (int i = 0; i < size1; i++)
+		destination[i] = events[start1 + i];
+
+	for (int i = 0; i < size2; i++)
+		destination[size1 + i] = events[start2 + i];
+
+	fifo.finishedRead(size1 + size2);
+	return size1 + size2;
+}
+
+/**
+*Discards all waiting events. Must not be called while other threads push or pop.
+*/
+void ParameterEventQueue::reset()
+{
+	fifo.reset();
+}
+
+/**
+*Gets the maximum number of events the queue can hold.
+*@return The capacity of the queue.
+*/
+int ParameterEventQueue::getCapacity() const
+{
+	return fifo.getTotalSize() - 1;
+}
@@ -0,0 +1,45 @@
+/*
+	==============================================================================
+
+	ParameterEventQueue
+	by Daniel Rothmann
+
+	A lock-free queue of timestamped parameter changes for the audio thread
+
+	==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/**
+* A parameter change which should land at a given sample within the next processed block.
+*/
+struct ParameterEvent
+{
+	int sampleOffset;
+	int index;
+	float value;
+};
+
+/**
+* A fixed-capacity queue of parameter events. Any number of control threads may push events,
+* serialized among themselves by a spin lock, while the audio thread pops them without locking or allocating.
+*/
+class ParameterEventQueue
+{
+public:
+	ParameterEventQueue(int capacity);
+	~ParameterEventQueue();
+
+	bool push(const ParameterEvent& event);
+	int pop(ParameterEvent* destination, int maxEvents);
+	void reset();
+
+	int getCapacity() const;
+
+private:
+	AbstractFifo fifo;
+	HeapBlock<ParameterEvent> events;
+	SpinLock writeLock;
+};
@@ -0,0 +1,133 @@
+/*
+	==============================================================================
+
+	ParameterNameIndex
+	by Daniel Rothmann
+
+	A hashed lookup table from parameter names to parameter indices
+
+	==============================================================================
+*/
+
+#include "ParameterNameIndex.h"
+
+/**
+*Constructs an empty index.
+*/
+ParameterNameIndex::ParameterNameIndex()
+{
+}
+
+ParameterNameIndex::~ParameterNameIndex()
+{
+}
+
+/**
+*Builds the index from the parameters of a processor. Named parameters are the ones preceding
+*the first parameter called "Bypass" or without a name.
+*@param processor The processor whose parameter names to index.
+*/
+void ParameterNameIndex::build(AudioProcessor& processor)
+{
+	clear();
+
+	const int numParameters = processor.getNumParameters();
+
+	while (numNamedParameters < numParameters)
+	{
+		const String name = processor.getParameterName(numNamedParameters);
+
+		if (name == "Bypass" || name.isEmpty())
+			break;
+
+		const CharPointer_UTF8 utf8 = name.toUTF8();
+		nameOffsets.add((int) nameData.getSize());
+		nameData.append(utf8.getAddress(), utf8.sizeInBytes());
+		numNamedParameters++;
+	}
+
+	// Keep the table at most half full so probe sequences stay short.
+	int numSlots = 16;
+	while (numSlots < numNamedParameters * 2)
+		numSlots *= 2;
+
+	slots.insertMultiple(0, -1, numSlots);
+
+	for (int index = 0; index < numNamedParameters; index++)
+	{
+		const char* name = static_cast<const char*>(nameData.getData()) + nameOffsets.getUnchecked(index);
+		int slot = (int) (hashName(name) & (uint32) (numSlots - 1));
+
+		while (slots.getUnchecked(slot) >= 0)
+		{
+			// Keep the first parameter when several share a name.
+			if (std::strcmp(name, static_cast<const char*>(nameData.getData()) + nameOffsets.getUnchecked(slots.getUnchecked(slot))) == 0)
+				break;
+
+			slot = (slot + 1) & (numSlots - 1);
+		}
+
+		if (slots.getUnchecked(slot) < 0)
+			slots.set(slot, index);
+	}
+}
+
+/**
+*Removes all entries from the index.
+*/
+void ParameterNameIndex::clear()
+{
+	nameData.reset();
+	nameOffsets.clear();
+	slots.clear();
+	numNamedParameters = 0;
+}
+
+/**
+*Finds the index of a named parameter without allocating.
+*@param name The UTF-8 encoded name of the parameter.
+*@return The index of the parameter. If no named parameter has that name, -1 is returned.
+*/
+int ParameterNameIndex::getIndex(const char* name) const
+{
+	if (name == nullptr || slots.isEmpty())
+		return -1;
+
+	const int mask = slots.size() - 1;
+	int slot = (int) (hashName(name) & (uint32) mask);
+
+	for (int index = slots.getUnchecked(slot); index >= 0; index = slots.getUnchecked(slot))
+	{
+		if (std::strcmp(name, static_cast<const char*>(nameData.getData()) + nameOffsets.getUnchecked(index)) == 0)
+			return index;
+
+		slot = (slot + 1) & mask;
+	}
+
+	return -1;
+}
+
+/**
+*Gets the number of named parameters found when the index was built.
+*@return The number of named parameters.
+*/
+int ParameterNameIndex::getNumNamedParameters() const
+{
+	return numNamedParameters;
+}
+
+/**
+*Hashes a null-terminated string with 32-bit FNV-1a.
+*/
+uint32 ParameterNameIndex::hashName(const char* name)
+{
+	uint32 hash = 2166136261u;
+
+	for (; *name != 0; name++)
+	{
+		hash ^= (uint32) (uint8) *name;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
@@ -0,0 +1,38 @@
+/*
+	==============================================================================
+
+	ParameterNameIndex
+	by Daniel Rothmann
+
+	A hashed lookup table from parameter names to parameter indices
+
+	==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/**
+* A hashed lookup table from parameter names to parameter indices.
+* The table is built once when a plugin is instantiated, after which lookups don't allocate.
+*/
+class ParameterNameIndex
+{
+public:
+	ParameterNameIndex();
+	~ParameterNameIndex();
+
+	void build(AudioProcessor& processor);
+	void clear();
+
+	int getIndex(const char* name) const;
+	int getNumNamedParameters() const;
+
+private:
+	static uint32 hashName(const char* name);
+
+	MemoryBlock nameData;
+	Array<int> nameOffsets;
+	Array<int> slots;
+	int numNamedParameters = 0;
+};
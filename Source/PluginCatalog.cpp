@@ -0,0 +1,338 @@
+/*
+	==============================================================================
+
+	PluginCatalog
+	by Daniel Rothmann
+
+	A compact, memory-mapped binary format for the list of known plugins
+
+	==============================================================================
+*/
+
+#include "PluginCatalog.h"
+#include "PluginIndex.h"
+
+namespace
+{
+	const char catalogMagic[8] = { 'M', 'P', 'H', 'C', 'A', 'T', 'L', 'G' };
+
+	/**
+	* Collects strings for the string table, storing each distinct string once.
+	*/
+	class StringTableBuilder
+	{
+	public:
+		uint32 add(const String& text)
+		{
+			if (offsets.contains(text))
+				return offsets[text];
+
+			const uint32 offset = (uint32) data.getDataSize();
+			data.write(text.toRawUTF8(), text.getNumBytesAsUTF8() + 1);
+			offsets.set(text, offset);
+			return offset;
+		}
+
+		MemoryOutputStream data;
+
+	private:
+		HashMap<String, uint32> offsets;
+	};
+}
+
+/**
+*Constructs a catalog which isn't open yet.
+*/
+PluginCatalog::PluginCatalog()
+{
+	zerostruct(header);
+}
+
+PluginCatalog::~PluginCatalog()
+{
+}
+
+/**
+*Writes the plugins and the blacklist of a list of known plugins to a catalog file.
+*@param list The list to write.
+*@param file The file to write to. It is replaced if it exists.
+*@return Wether the file was written.
+*/
+bool PluginCatalog::write(const KnownPluginList& list, const File& file)
+{
+	const int numRecords = list.getNumTypes();
+	const StringArray& blacklist = list.getBlacklistedFiles();
+
+	// Keep the indices at most half full so probe sequences stay short.
+	uint32 numHashSlots = 16;
+	while (numHashSlots < (uint32) numRecords * 2)
+		numHashSlots *= 2;
+
+	StringTableBuilder strings;
+	strings.add(String());
+	HeapBlock<Record> records((size_t) jmax(1, numRecords), true);
+	HeapBlock<uint32> identifierIndex((size_t) numHashSlots, true);
+	HeapBlock<uint32> fileIndex((size_t) numHashSlots, true);
+	HeapBlock<uint32> blacklistOffsets((size_t) jmax(1, blacklist.size()), true);
+
+	for (int i = 0; i < numRecords; i++)
+	{
+		const PluginDescription& description = *list.getType(i);
+		const String identifierKey = PluginIndex::createIdentifierKey(description.createIdentifierString());
+		Record& record = records[i];
+
+		record.nameOffset = strings.add(description.name);
+		record.descriptiveNameOffset = strings.add(description.descriptiveName);
+		record.formatNameOffset = strings.add(description.pluginFormatName);
+		record.categoryOffset = strings.add(description.category);
+		record.manufacturerOffset = strings.add(description.manufacturerName);
+		record.versionOffset = strings.add(description.version);
+		record.fileOrIdentifierOffset = strings.add(description.fileOrIdentifier);
+		record.identifierKeyOffset = strings.add(identifierKey);
+		record.lastFileModTime = description.lastFileModTime.toMilliseconds();
+		record.uid = description.uid;
+		record.numInputChannels = description.numInputChannels;
+		record.numOutputChannels = description.numOutputChannels;
+		record.flags = (description.isInstrument ? isInstrument : 0u) | (description.hasSharedContainer ? hasSharedContainer : 0u);
+
+		// Slots hold the record index plus one, so zero marks an empty slot.
+		const uint32 keys[] = { hashString(identifierKey.toRawUTF8()), hashString(description.fileOrIdentifier.toRawUTF8()) };
+		uint32* indices[] = { identifierIndex, fileIndex };
+
+		for (int table = 0; table < 2; table++)
+		{
+			uint32 slot = keys[table] & (numHashSlots - 1);
+
+			while (indices[table][slot] != 0)
+				slot = (slot + 1) & (numHashSlots - 1);
+
+			indices[table][slot] = (uint32) i + 1;
+		}
+	}
+
+	for (int i = 0; i < blacklist.size(); i++)
+		blacklistOffsets[i] = strings.add(blacklist[i]);
+
+	Header fileHeader;
+	zerostruct(fileHeader);
+	memcpy(fileHeader.magic, catalogMagic, sizeof(catalogMagic));
+	fileHeader.version = currentVersion;
+	fileHeader.numRecords = (uint32) numRecords;
+	fileHeader.numHashSlots = numHashSlots;
+	fileHeader.recordsOffset = (uint32) sizeof(Header);
+	fileHeader.identifierIndexOffset = fileHeader.recordsOffset + (uint32) (sizeof(Record) * (size_t) numRecords);
+	fileHeader.fileIndexOffset = fileHeader.identifierIndexOffset + numHashSlots * (uint32) sizeof(uint32);
+	fileHeader.numBlacklisted = (uint32) blacklist.size();
+	fileHeader.blacklistOffset = fileHeader.fileIndexOffset + numHashSlots * (uint32) sizeof(uint32);
+	fileHeader.stringsOffset = fileHeader.blacklistOffset + fileHeader.numBlacklisted * (uint32) sizeof(uint32);
+	fileHeader.stringsSize = (uint32) strings.data.getDataSize();
+
+	TemporaryFile temporaryFile(file);
+	{
+		FileOutputStream stream(temporaryFile.getFile());
+
+		if (stream.failedToOpen())
+			return false;
+
+		stream.write(&fileHeader, sizeof(Header));
+		stream.write(records, sizeof(Record) * (size_t) numRecords);
+		stream.write(identifierIndex, sizeof(uint32) * numHashSlots);
+		stream.write(fileIndex, sizeof(uint32) * numHashSlots);
+		stream.write(blacklistOffsets, sizeof(uint32) * (size_t) blacklist.size());
+		stream.write(strings.data.getData(), strings.data.getDataSize());
+		stream.flush();
+
+		if (stream.getStatus().failed())
+			return false;
+	}
+
+	// Replace the file in one step, so a catalog which is mapped elsewhere is never seen half written.
+	return temporaryFile.overwriteTargetFileWithTemporary();
+}
+
+/**
+*Maps a catalog file into memory and checks its header. Nothing is decoded until plugins are looked up.
+*@param file The catalog file.
+*@return Wether the file is a catalog of the current version.
+*/
+bool PluginCatalog::open(const File& file)
+{
+	mappedFile = new MemoryMappedFile(file, MemoryMappedFile::readOnly);
+	data = static_cast<const char*>(mappedFile->getData());
+	const size_t size = mappedFile->getSize();
+
+	// The records are read as they are laid out in memory, which is little-endian on every platform this builds for.
+	if (data == nullptr || size < sizeof(Header) || ByteOrder::isBigEndian())
+	{
+		mappedFile = nullptr;
+		data = nullptr;
+		zerostruct(header);
+		return false;
+	}
+
+	memcpy(&header, data, sizeof(Header));
+
+	const uint64 indexSize = (uint64) header.numHashSlots * sizeof(uint32);
+
+	// Probing relies on a non-empty power of two slots with room for every record, which the writer always leaves.
+	if (memcmp(header.magic, catalogMagic, sizeof(catalogMagic)) != 0 || header.version != currentVersion
+		|| header.numHashSlots == 0 || !isPowerOfTwo(header.numHashSlots) || header.numHashSlots < header.numRecords
+		|| header.recordsOffset + (uint64) header.numRecords * sizeof(Record) > size
+		|| header.identifierIndexOffset + indexSize > size || header.fileIndexOffset + indexSize > size
+		|| header.blacklistOffset + (uint64) header.numBlacklisted * sizeof(uint32) > size
+		|| header.stringsOffset + (uint64) header.stringsSize > size
+		|| header.stringsSize == 0 || data[header.stringsOffset + header.stringsSize - 1] != 0)
+	{
+		mappedFile = nullptr;
+		data = nullptr;
+		zerostruct(header);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+*Gets the number of plugins in the catalog.
+*@return The number of plugins, or 0 if no catalog is open.
+*/
+int PluginCatalog::getNumPlugins() const
+{
+	return (int) header.numRecords;
+}
+
+/**
+*Decodes one plugin of the catalog.
+*@param index The index of the plugin.
+*@param description The description to fill in.
+*@return Wether there is a plugin at that index.
+*/
+bool PluginCatalog::getPlugin(int index, PluginDescription& description) const
+{
+	if (!isPositiveAndBelow(index, getNumPlugins()))
+		return false;
+
+	const Record record = readRecord(index);
+
+	description.name = String::fromUTF8(getString(record.nameOffset));
+	description.descriptiveName = String::fromUTF8(getString(record.descriptiveNameOffset));
+	description.pluginFormatName = String::fromUTF8(getString(record.formatNameOffset));
+	description.category = String::fromUTF8(getString(record.categoryOffset));
+	description.manufacturerName = String::fromUTF8(getString(record.manufacturerOffset));
+	description.version = String::fromUTF8(getString(record.versionOffset));
+	description.fileOrIdentifier = String::fromUTF8(getString(record.fileOrIdentifierOffset));
+	description.lastFileModTime = Time(record.lastFileModTime);
+	description.uid = record.uid;
+	description.numInputChannels = record.numInputChannels;
+	description.numOutputChannels = record.numOutputChannels;
+	description.isInstrument = (record.flags & isInstrument) != 0;
+	description.hasSharedContainer = (record.flags & hasSharedContainer) != 0;
+	return true;
+}
+
+/**
+*Finds a plugin by its identifier string through the prebuilt hash index, matching it like PluginIndex does.
+*@param identifier The identifier string of the plugin.
+*@return The index of the plugin, or -1 if it isn't in the catalog.
+*/
+int PluginCatalog::findPluginForIdentifier(const String& identifier) const
+{
+	return findInIndex(header.identifierIndexOffset, PluginIndex::createIdentifierKey(identifier), true);
+}
+
+/**
+*Finds the first plugin of a file through the prebuilt hash index.
+*@param fileOrIdentifier The path of the plugin file.
+*@return The index of the plugin, or -1 if it isn't in the catalog.
+*/
+int PluginCatalog::findPluginForFile(const String& fileOrIdentifier) const
+{
+	return findInIndex(header.fileIndexOffset, fileOrIdentifier, false);
+}
+
+/**
+*Gets the blacklisted files stored in the catalog.
+*@return The paths of the files.
+*/
+StringArray PluginCatalog::getBlacklistedFiles() const
+{
+	StringArray files;
+
+	for (uint32 i = 0; i < header.numBlacklisted; i++)
+	{
+		uint32 offset;
+		memcpy(&offset, data + header.blacklistOffset + i * sizeof(uint32), sizeof(uint32));
+		files.add(String::fromUTF8(getString(offset)));
+	}
+
+	return files;
+}
+
+/**
+*Copies a record out of the mapped file.
+*/
+PluginCatalog::Record PluginCatalog::readRecord(int index) const
+{
+	Record record;
+	memcpy(&record, data + header.recordsOffset + (size_t) index * sizeof(Record), sizeof(Record));
+	return record;
+}
+
+/**
+*Gets a string from the string table. Offsets outside of it give an empty string.
+*/
+const char* PluginCatalog::getString(uint32 offset) const
+{
+	if (offset >= header.stringsSize)
+		return "";
+
+	return data + header.stringsOffset + offset;
+}
+
+/**
+*Probes one of the hash indices for a key, comparing against the identifier key or file of each candidate record.
+*/
+int PluginCatalog::findInIndex(uint32 indexOffset, const String& key, bool byIdentifier) const
+{
+	if (data == nullptr || header.numRecords == 0 || header.numHashSlots == 0)
+		return -1;
+
+	const char* keyText = key.toRawUTF8();
+	const uint32 mask = header.numHashSlots - 1;
+	uint32 slot = hashString(keyText) & mask;
+
+	for (uint32 probe = 0; probe < header.numHashSlots; probe++)
+	{
+		uint32 entry;
+		memcpy(&entry, data + indexOffset + slot * sizeof(uint32), sizeof(uint32));
+
+		// Slots hold the record index plus one, so anything above the number of records is corrupt.
+		if (entry == 0 || entry > header.numRecords)
+			return -1;
+
+		const Record record = readRecord((int) entry - 1);
+
+		if (std::strcmp(keyText, getString(byIdentifier ? record.identifierKeyOffset : record.fileOrIdentifierOffset)) == 0)
+			return (int) entry - 1;
+
+		slot = (slot + 1) & mask;
+	}
+
+	return -1;
+}
+
+/**
+*Hashes a null-terminated string with 32-bit FNV-1a.
+*/
+uint32 PluginCatalog::hashString(const char* text)
+{
+	uint32 hash = 2166136261u;
+
+	for (; *text != 0; text++)
+	{
+		hash ^= (uint32) (uint8) *text;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
@@ -0,0 +1,84 @@
+/*
+	==============================================================================
+
+	PluginCatalog
+	by Daniel Rothmann
+
+	A compact, memory-mapped binary format for the list of known plugins
+
+	==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/**
+* A read-only catalog of plugin descriptions in a compact binary file. The file holds a header, fixed-size records,
+* hash indices by identifier key and by file, the blacklist and a table of null-terminated UTF-8 strings.
+* It is memory-mapped when opened, and records are only decoded when they are looked up.
+*/
+class PluginCatalog
+{
+public:
+	PluginCatalog();
+	~PluginCatalog();
+
+	static bool write(const KnownPluginList& list, const File& file);
+
+	bool open(const File& file);
+	int getNumPlugins() const;
+	bool getPlugin(int index, PluginDescription& description) const;
+	int findPluginForIdentifier(const String& identifier) const;
+	int findPluginForFile(const String& fileOrIdentifier) const;
+	StringArray getBlacklistedFiles() const;
+
+	static const uint32 currentVersion = 2;
+
+private:
+	struct Header
+	{
+		char magic[8];
+		uint32 version;
+		uint32 numRecords;
+		uint32 numHashSlots;
+		uint32 recordsOffset;
+		uint32 identifierIndexOffset;
+		uint32 fileIndexOffset;
+		uint32 numBlacklisted;
+		uint32 blacklistOffset;
+		uint32 stringsOffset;
+		uint32 stringsSize;
+	};
+
+	struct Record
+	{
+		uint32 nameOffset;
+		uint32 descriptiveNameOffset;
+		uint32 formatNameOffset;
+		uint32 categoryOffset;
+		uint32 manufacturerOffset;
+		uint32 versionOffset;
+		uint32 fileOrIdentifierOffset;
+		uint32 identifierKeyOffset;
+		int64 lastFileModTime;
+		int32 uid;
+		int32 numInputChannels;
+		int32 numOutputChannels;
+		uint32 flags;
+	};
+
+	enum RecordFlags
+	{
+		isInstrument = 1,
+		hasSharedContainer = 2
+	};
+
+	Record readRecord(int index) const;
+	const char* getString(uint32 offset) const;
+	int findInIndex(uint32 indexOffset, const String& key, bool byIdentifier) const;
+	static uint32 hashString(const char* text);
+
+	ScopedPointer<MemoryMappedFile> mappedFile;
+	const char* data = nullptr;
+	Header header;
+};
@@ -0,0 +1,221 @@
+/*
+	==============================================================================
+
+	PluginChain
+	by Daniel Rothmann
+
+	A serial chain of plugin hosts which processes a block through every plugin in one call
+
+	==============================================================================
+*/
+
+#include "PluginChain.h"
+
+/**
+*Constructs an empty chain.
+*@param sampleRate The sample rate to initialize plugins with.
+*@param bufferSize The buffer size to initialize plugins with.
+*/
+PluginChain::PluginChain(double sampleRate, int bufferSize)
+	: currentSampleRate(sampleRate), currentBlockSize(bufferSize)
+{
+}
+
+PluginChain::~PluginChain()
+{
+}
+
+/**
+*Instantiates a plugin, prepares it for playback and inserts it into the chain.
+*@param xmlPluginDescription A string containing the XML Document which can be read as a PluginDescription.
+*@param insertIndex The position in the chain to insert the plugin at. If out of range, the plugin is appended.
+*@return The position of the plugin in the chain. If instantiation failed, -1 is returned.
+*/
+int PluginChain::insertPlugin(char* xmlPluginDescription, int insertIndex)
+{
+	ScopedPointer<PluginHost> host = new PluginHost();
+	host->setHeadless(true);
+
+	if (!host->instantiatePlugin(xmlPluginDescription, currentSampleRate, currentBlockSize))
+		return -1;
+
+	host->prepareToPlay(currentSampleRate, currentBlockSize);
+
+	const ScopedLock control(controlLock);
+	const ScopedLock lock(chainLock);
+
+	if (insertIndex < 0 || insertIndex > hosts.size())
+		insertIndex = hosts.size();
+
+	hosts.insert(insertIndex, host.release());
+	allocateChainChannels();
+	return insertIndex;
+}
+
+/**
+*Removes a plugin from the chain and releases it.
+*@param index The position of the plugin in the chain.
+*@return Wether the plugin was removed. If there is no plugin at index, false is returned.
+*/
+bool PluginChain::removePlugin(int index)
+{
+	ScopedPointer<PluginHost> host;
+
+	{
+		const ScopedLock control(controlLock);
+		const ScopedLock lock(chainLock);
+
+		if (!isPositiveAndBelow(index, hosts.size()))
+			return false;
+
+		host = hosts.removeAndReturn(index);
+		allocateChainChannels();
+	}
+
+	// Release outside the lock so processing can resume while the plugin shuts down.
+	host->releasePlugin();
+	return true;
+}
+
+/**
+*Moves a plugin to another position in the chain.
+*@param currentIndex The current position of the plugin.
+*@param newIndex The position to move the plugin to.
+*@return Wether the plugin was moved. If either position is out of range, false is returned.
+*/
+bool PluginChain::movePlugin(int currentIndex, int newIndex)
+{
+	const ScopedLock control(controlLock);
+	const ScopedLock lock(chainLock);
+
+	if (!isPositiveAndBelow(currentIndex, hosts.size()) || !isPositiveAndBelow(newIndex, hosts.size()))
+		return false;
+
+	hosts.move(currentIndex, newIndex);
+	return true;
+}
+
+/**
+*Gets the number of plugins in the chain. Only takes the control lock, so polling it never makes processing pass a block through.
+*@return The number of plugins.
+*/
+int PluginChain::getNumPlugins()
+{
+	const ScopedLock control(controlLock);
+	return hosts.size();
+}
+
+/**
+*Gets the host of a plugin in the chain, for setting parameters. The chain keeps owning the host: it is deleted when the
+*plugin is removed or the chain is deleted, so the pointer must not be kept across removePlugin or used while another
+*thread may remove the plugin. Moving plugins leaves it valid, but it may then be at another position.
+*@param index The position of the plugin in the chain.
+*@return The host of the plugin. If there is no plugin at index, nullptr is returned.
+*/
+PluginHost* PluginChain::getPlugin(int index)
+{
+	const ScopedLock control(controlLock);
+	return hosts[index];
+}
+
+/**
+*Prepares every plugin in the chain for playback.
+*@param sampleRate The sample rate to initialize plugins with.
+*@param expectedSamplesPerBlock The maximum buffer size to expect.
+*/
+void PluginChain::prepareToPlay(double sampleRate, int expectedSamplesPerBlock)
+{
+	const ScopedLock control(controlLock);
+	const ScopedLock lock(chainLock);
+
+	currentSampleRate = sampleRate;
+	currentBlockSize = expectedSamplesPerBlock;
+
+	for (auto* host : hosts)
+		host->prepareToPlay(sampleRate, expectedSamplesPerBlock);
+
+	allocateChainChannels();
+}
+
+/**
+*Tells every plugin in the chain wether it is rendering offline.
+*@param isNonRealtime Wether processing is offline.
+*/
+void PluginChain::setNonRealtime(bool isNonRealtime)
+{
+	const ScopedLock control(controlLock);
+
+	for (auto* host : hosts)
+		host->setNonRealtime(isNonRealtime);
+}
+
+/**
+*Processes a block of planar audio through every plugin in the chain, in place.
+*Channels a plugin produces beyond what the caller provides are carried to the next plugin in shared scratch channels.
+*If the chain is being changed on another thread, the block is passed through unprocessed.
+*@param channels An array of pointers to the audio data of each channel.
+*@param numChannels The number of channel pointers in channels.
+*@param numSamples The number of samples in each channel.
+*/
+void PluginChain::processBlock(float** channels, int numChannels, int numSamples)
+{
+	const ScopedTryLock lock(chainLock);
+
+	if (!lock.isLocked() || channels == nullptr || hosts.isEmpty())
+		return;
+
+	// Channels beyond the widest plugin are never touched, so they are left out of the pointer table.
+	const int numChannelsToProcess = numChainChannels;
+	const int maxBlockSize = chainChannels.getNumSamples();
+
+	for (int offset = 0; offset < numSamples; offset += maxBlockSize)
+	{
+		const int blockLength = jmin(numSamples - offset, maxBlockSize);
+
+		for (int channel = 0; channel < numChannelsToProcess; channel++)
+		{
+			if (channel < numChannels)
+			{
+				chainPointers[channel] = channels[channel] + offset;
+			}
+			else
+			{
+				chainPointers[channel] = chainChannels.getWritePointer(channel);
+				FloatVectorOperations::clear(chainPointers[channel], blockLength);
+			}
+		}
+
+		for (auto* host : hosts)
+			host->processBlockPlanar(chainPointers, numChannelsToProcess, blockLength);
+	}
+}
+
+/**
+*Gets the total latency of the chain, summed across every plugin and any re-blocking done by their hosts.
+*Only takes the control lock, so polling it never makes processing pass a block through.
+*@return The latency in samples.
+*/
+int PluginChain::getLatencySamples()
+{
+	const ScopedLock control(controlLock);
+	int latency = 0;
+
+	for (auto* host : hosts)
+		latency += host->getLatencySamples() + host->getHostLatencySamples();
+
+	return latency;
+}
+
+/**
+*Sizes the scratch channels shared by every plugin in the chain to the widest plugin.
+*/
+void PluginChain::allocateChainChannels()
+{
+	numChainChannels = 0;
+
+	for (auto* host : hosts)
+		numChainChannels = jmax(numChainChannels, host->getNumInputs(), host->getNumOutputs());
+
+	chainPointers.allocate((size_t) jmax(1, numChainChannels), true);
+	chainChannels.setSize(jmax(1, numChainChannels), jmax(1, currentBlockSize));
+}
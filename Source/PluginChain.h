@@ -0,0 +1,50 @@
+/*
+	==============================================================================
+
+	PluginChain
+	by Daniel Rothmann
+
+	A serial chain of plugin hosts which processes a block through every plugin in one call
+
+	==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PluginHost.h"
+
+/**
+* A serial chain of plugin hosts which processes a block through every plugin in one call.
+*/
+class PluginChain
+{
+public:
+	PluginChain(double sampleRate, int bufferSize);
+	~PluginChain();
+
+	int insertPlugin(char* xmlPluginDescription, int insertIndex);
+	bool removePlugin(int index);
+	bool movePlugin(int currentIndex, int newIndex);
+	int getNumPlugins();
+	PluginHost* getPlugin(int index);
+
+	void prepareToPlay(double sampleRate, int expectedSamplesPerBlock);
+	void setNonRealtime(bool isNonRealtime);
+	void processBlock(float** channels, int numChannels, int numSamples);
+	int getLatencySamples();
+
+private:
+	void allocateChainChannels();
+
+	OwnedArray<PluginHost> hosts;
+	// Control threads reading or changing the chain take controlLock. Only changes also take chainLock, which processBlock tries to take.
+	CriticalSection controlLock;
+	CriticalSection chainLock;
+
+	double currentSampleRate;
+	int currentBlockSize;
+
+	HeapBlock<float*> chainPointers;
+	AudioBuffer<float> chainChannels;
+	int numChainChannels = 0;
+};
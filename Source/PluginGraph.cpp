@@ -0,0 +1,337 @@
+/*
+	==============================================================================
+
+	PluginGraph
+	by Daniel Rothmann
+
+	A graph of plugin hosts whose independent branches are processed in parallel
+
+	==============================================================================
+*/
+
+#include "PluginGraph.h"
+
+/**
+*Constructs an empty graph and starts its worker threads.
+*@param sampleRate The sample rate to initialize plugins with.
+*@param bufferSize The buffer size to initialize plugins with.
+*@param numWorkers The number of worker threads helping the calling thread process each block.
+*/
+PluginGraph::PluginGraph(double sampleRate, int bufferSize, int numWorkers)
+	: currentSampleRate(sampleRate), currentBlockSize(jmax(1, bufferSize))
+{
+	// The thread calling processBlock takes part as participant 0.
+	for (int participant = 0; participant <= jmax(0, numWorkers); participant++)
+		deques.add(new WorkStealingDeque());
+
+	workers = new BlockWorkerGroup(*this, "PluginGraph worker", deques.size() - 1, false);
+	allocateNodeBuffers();
+}
+
+PluginGraph::~PluginGraph()
+{
+	// Stop the workers before the nodes and deques they use are destroyed.
+	workers = nullptr;
+}
+
+/**
+*Instantiates a plugin, prepares it for playback and adds it to the graph as an unconnected node.
+*@param xmlPluginDescription A string containing the XML Document which can be read as a PluginDescription.
+*@return The index of the new node. If instantiation failed, -1 is returned.
+*/
+int PluginGraph::addNode(char* xmlPluginDescription)
+{
+	ScopedPointer<PluginHost> host = new PluginHost();
+	host->setHeadless(true);
+
+	if (!host->instantiatePlugin(xmlPluginDescription, currentSampleRate, currentBlockSize))
+		return -1;
+
+	host->prepareToPlay(currentSampleRate, currentBlockSize);
+
+	const ScopedLock control(controlLock);
+	const ScopedLock lock(graphLock);
+
+	auto* node = new Node();
+	node->host = host.release();
+	nodes.add(node);
+
+	sortTopologically();
+	allocateNodeBuffers();
+	return nodes.size() - 1;
+}
+
+/**
+*Routes the output of one node into the input of another. Connections which would create a cycle are refused.
+*@param sourceNode The index of the node whose output to route.
+*@param destinationNode The index of the node which should receive it.
+*@return Wether the connection was made.
+*/
+bool PluginGraph::connectNodes(int sourceNode, int destinationNode)
+{
+	const ScopedLock control(controlLock);
+	const ScopedLock lock(graphLock);
+
+	if (!isPositiveAndBelow(sourceNode, nodes.size()) || !isPositiveAndBelow(destinationNode, nodes.size())
+		|| sourceNode == destinationNode || nodes[sourceNode]->outputs.contains(destinationNode))
+		return false;
+
+	nodes[sourceNode]->outputs.add(destinationNode);
+	nodes[destinationNode]->inputs.add(sourceNode);
+
+	if (!sortTopologically())
+	{
+		nodes[sourceNode]->outputs.removeFirstMatchingValue(destinationNode);
+		nodes[destinationNode]->inputs.removeFirstMatchingValue(sourceNode);
+		sortTopologically();
+		return false;
+	}
+
+	return true;
+}
+
+/**
+*Removes a connection between two nodes.
+*@param sourceNode The index of the node whose output is routed.
+*@param destinationNode The index of the node receiving it.
+*@return Wether the connection existed and was removed.
+*/
+bool PluginGraph::disconnectNodes(int sourceNode, int destinationNode)
+{
+	const ScopedLock control(controlLock);
+	const ScopedLock lock(graphLock);
+
+	if (!isPositiveAndBelow(sourceNode, nodes.size()) || !isPositiveAndBelow(destinationNode, nodes.size())
+		|| !nodes[sourceNode]->outputs.contains(destinationNode))
+		return false;
+
+	nodes[sourceNode]->outputs.removeFirstMatchingValue(destinationNode);
+	nodes[destinationNode]->inputs.removeFirstMatchingValue(sourceNode);
+	sortTopologically();
+	return true;
+}
+
+/**
+*Gets the number of nodes in the graph. Only takes the control lock, so polling it never makes processing pass a block through.
+*@return The number of nodes.
+*/
+int PluginGraph::getNumNodes()
+{
+	const ScopedLock control(controlLock);
+	return nodes.size();
+}
+
+/**
+*Gets the host of a node, for setting parameters.
+*@param node The index of the node.
+*@return The host of the node. If there is no node at that index, nullptr is returned.
+*/
+PluginHost* PluginGraph::getNode(int node)
+{
+	const ScopedLock control(controlLock);
+
+	if (isPositiveAndBelow(node, nodes.size()))
+		return nodes[node]->host;
+
+	return nullptr;
+}
+
+/**
+*Prepares every plugin in the graph for playback and resizes the buffers between nodes.
+*@param sampleRate The sample rate to initialize plugins with.
+*@param expectedSamplesPerBlock The maximum buffer size to expect.
+*/
+void PluginGraph::prepareToPlay(double sampleRate, int expectedSamplesPerBlock)
+{
+	const ScopedLock control(controlLock);
+	const ScopedLock lock(graphLock);
+
+	currentSampleRate = sampleRate;
+	currentBlockSize = jmax(1, expectedSamplesPerBlock);
+
+	for (auto* node : nodes)
+		node->host->prepareToPlay(currentSampleRate, currentBlockSize);
+
+	allocateNodeBuffers();
+}
+
+/**
+*Processes a block of planar audio through the graph, in place.
+*If the graph is being changed on another thread, the block is passed through unprocessed.
+*@param channels An array of pointers to the audio data of each channel.
+*@param numChannels The number of channel pointers in channels.
+*@param numSamples The number of samples in each channel.
+*/
+void PluginGraph::processBlock(float** channels, int numChannels, int numSamples)
+{
+	const ScopedTryLock lock(graphLock);
+
+	if (!lock.isLocked() || channels == nullptr || nodes.isEmpty())
+		return;
+
+	const int numChannelsToProcess = jmin(numChannels, numGraphChannels);
+
+	for (int offset = 0; offset < numSamples; offset += currentBlockSize)
+	{
+		const int blockLength = jmin(numSamples - offset, currentBlockSize);
+
+		graphInput.clear(0, blockLength);
+
+		for (int channel = 0; channel < numChannelsToProcess; channel++)
+			graphInput.copyFrom(channel, 0, channels[channel] + offset, blockLength);
+
+		processSubBlock(blockLength);
+
+		for (int channel = 0; channel < numChannelsToProcess; channel++)
+		{
+			float* output = channels[channel] + offset;
+			FloatVectorOperations::clear(output, blockLength);
+
+			for (int sink : sinkNodes)
+				FloatVectorOperations::add(output, nodes.getUnchecked(sink)->buffer.getReadPointer(channel), blockLength);
+		}
+	}
+}
+
+/**
+*Checks the graph for cycles by sorting it topologically, and collects the nodes where processing starts and ends.
+*@return Wether the graph is acyclic.
+*/
+bool PluginGraph::sortTopologically()
+{
+	sourceNodes.clearQuick();
+	sinkNodes.clearQuick();
+
+	Array<int> remainingInputs;
+	Array<int> ready;
+
+	for (int index = 0; index < nodes.size(); index++)
+	{
+		remainingInputs.add(nodes[index]->inputs.size());
+
+		if (nodes[index]->inputs.isEmpty())
+		{
+			sourceNodes.add(index);
+			ready.add(index);
+		}
+
+		if (nodes[index]->outputs.isEmpty())
+			sinkNodes.add(index);
+	}
+
+	int numSorted = 0;
+
+	for (; numSorted < ready.size(); numSorted++)
+	{
+		for (int output : nodes[ready[numSorted]]->outputs)
+		{
+			remainingInputs.getReference(output)--;
+
+			if (remainingInputs[output] == 0)
+				ready.add(output);
+		}
+	}
+
+	return numSorted == nodes.size();
+}
+
+/**
+*Sizes the buffers between nodes to the widest plugin and the prepared block size.
+*/
+void PluginGraph::allocateNodeBuffers()
+{
+	numGraphChannels = 1;
+
+	for (auto* node : nodes)
+		numGraphChannels = jmax(numGraphChannels, node->host->getNumInputs(), node->host->getNumOutputs());
+
+	for (auto* node : nodes)
+		node->buffer.setSize(numGraphChannels, currentBlockSize);
+
+	graphInput.setSize(numGraphChannels, currentBlockSize);
+
+	for (auto* deque : deques)
+		deque->setCapacity(jmax(1, nodes.size()));
+}
+
+/**
+*Runs every node once on a block no longer than the prepared block size, spreading ready nodes across the workers.
+*@param numSamples The number of samples in the block.
+*/
+void PluginGraph::processSubBlock(int numSamples)
+{
+	currentNumSamples = numSamples;
+	completedNodes.store(0, std::memory_order_relaxed);
+
+	for (auto* deque : deques)
+		deque->reset();
+
+	for (auto* node : nodes)
+		node->pendingInputs.store(node->inputs.size(), std::memory_order_relaxed);
+
+	for (int source : sourceNodes)
+		deques.getUnchecked(0)->push(source);
+
+	// Returns once every worker has left the block, so the deques can be reused.
+	workers->runBlock();
+}
+
+/**
+*Processes ready nodes until the whole graph is done, taking work from the participant's own deque first and stealing from others when it runs dry.
+*@param participant The index of the participating thread's deque.
+*/
+void PluginGraph::runParticipant(int participant)
+{
+	const int numNodes = nodes.size();
+	const int numParticipants = deques.size();
+	WorkStealingDeque& ownDeque = *deques.getUnchecked(participant);
+
+	while (completedNodes.load(std::memory_order_acquire) < numNodes)
+	{
+		int node;
+		bool foundWork = ownDeque.pop(node);
+
+		for (int i = 1; !foundWork && i < numParticipants; i++)
+			foundWork = deques.getUnchecked((participant + i) % numParticipants)->steal(node);
+
+		if (foundWork)
+			processNode(participant, node);
+		else
+			Thread::yield();
+	}
+}
+
+/**
+*Mixes the inputs of a node, runs its plugin and marks the nodes depending on it as ready once all their inputs are done.
+*@param participant The index of the participating thread's deque.
+*@param node The index of the node to process.
+*/
+void PluginGraph::processNode(int participant, int node)
+{
+	Node& current = *nodes.getUnchecked(node);
+	const int numSamples = currentNumSamples;
+
+	if (current.inputs.isEmpty())
+	{
+		for (int channel = 0; channel < numGraphChannels; channel++)
+			current.buffer.copyFrom(channel, 0, graphInput, channel, 0, numSamples);
+	}
+	else
+	{
+		current.buffer.clear(0, numSamples);
+
+		for (int input : current.inputs)
+			for (int channel = 0; channel < numGraphChannels; channel++)
+				current.buffer.addFrom(channel, 0, nodes.getUnchecked(input)->buffer, channel, 0, numSamples);
+	}
+
+	current.host->processBlockPlanar(current.buffer.getArrayOfWritePointers(), numGraphChannels, numSamples);
+
+	for (int output : current.outputs)
+	{
+		if (nodes.getUnchecked(output)->pendingInputs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			deques.getUnchecked(participant)->push(output);
+	}
+
+	completedNodes.fetch_add(1, std::memory_order_acq_rel);
+}
@@ -0,0 +1,74 @@
+/*
+	==============================================================================
+
+	PluginGraph
+	by Daniel Rothmann
+
+	A graph of plugin hosts whose independent branches are processed in parallel
+
+	==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PluginHost.h"
+#include "WorkStealingDeque.h"
+#include "BlockWorkerGroup.h"
+#include <atomic>
+
+/**
+* A directed acyclic graph of plugin hosts. Nodes without inputs read the block passed to the graph,
+* and the outputs of nodes without outputs are summed into it. Each block, nodes whose inputs are ready
+* are handed to a fixed pool of worker threads through lock-free work-stealing deques.
+*/
+class PluginGraph : private BlockWorkerGroup::Job
+{
+public:
+	PluginGraph(double sampleRate, int bufferSize, int numWorkers);
+	~PluginGraph();
+
+	int addNode(char* xmlPluginDescription);
+	bool connectNodes(int sourceNode, int destinationNode);
+	bool disconnectNodes(int sourceNode, int destinationNode);
+	int getNumNodes();
+	PluginHost* getNode(int node);
+
+	void prepareToPlay(double sampleRate, int expectedSamplesPerBlock);
+	void processBlock(float** channels, int numChannels, int numSamples);
+
+private:
+	struct Node
+	{
+		ScopedPointer<PluginHost> host;
+		Array<int> inputs;
+		Array<int> outputs;
+		AudioBuffer<float> buffer;
+		std::atomic<int> pendingInputs { 0 };
+	};
+
+	bool sortTopologically();
+	void allocateNodeBuffers();
+	void processSubBlock(int numSamples);
+	void runParticipant(int participant) override;
+	void processNode(int participant, int node);
+
+	OwnedArray<Node> nodes;
+	OwnedArray<WorkStealingDeque> deques;
+
+	// Control threads reading or changing the graph take controlLock. Only changes also take graphLock, which processBlock tries to take.
+	CriticalSection controlLock;
+	CriticalSection graphLock;
+
+	double currentSampleRate;
+	int currentBlockSize;
+	int numGraphChannels = 0;
+
+	AudioBuffer<float> graphInput;
+	Array<int> sourceNodes;
+	Array<int> sinkNodes;
+	int currentNumSamples = 0;
+
+	std::atomic<int> completedNodes { 0 };
+
+	ScopedPointer<BlockWorkerGroup> workers;
+};
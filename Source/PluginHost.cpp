@@ -10,6 +10,122 @@
 */
 
 #include "PluginHost.h"
+#include "InterleavedAudio.h"
+#include "PrecisionConversion.h"
+
+/**
+* Instantiates a plugin for a host on one of the loader threads.
+*/
+class PluginHost::InstantiationJob : public ThreadPoolJob
+{
+public:
+	InstantiationJob(PluginHost& owner, const String& description, double rate, int blockSize, InstantiationCallback completionCallback)
+		: ThreadPoolJob("Plugin instantiation"), host(owner), xmlPluginDescription(description),
+		  sampleRate(rate), bufferSize(blockSize), callback(completionCallback)
+	{
+	}
+
+	JobStatus runJob() override
+	{
+		bool succeeded;
+
+		// Some formats need a running message thread while creating an instance, so hand those over to it.
+		if (host.requiresMessageThreadForCreation(xmlPluginDescription.toRawUTF8()) && MessageManager::getInstanceWithoutCreating() != nullptr)
+		{
+			if (!instantiateOnMessageThread(succeeded))
+				return jobHasFinished;
+		}
+		else
+		{
+			succeeded = instantiate();
+		}
+
+		host.instantiationState = succeeded ? instantiated : instantiationFailed;
+
+		if (callback != nullptr)
+			callback(&host, succeeded);
+
+		return jobHasFinished;
+	}
+
+private:
+	/**
+	* Runs the instantiation when the message thread gets to it, unless the job was cancelled first.
+	*/
+	class CreationMessage : public CallbackMessage
+	{
+	public:
+		CreationMessage(InstantiationJob& owner) : job(owner) {}
+
+		void messageCallback() override
+		{
+			const ScopedLock lock(cancelLock);
+
+			if (!cancelled)
+				succeeded = job.instantiate();
+
+			finished.signal();
+		}
+
+		InstantiationJob& job;
+		CriticalSection cancelLock;
+		WaitableEvent finished;
+		bool cancelled = false;
+		bool succeeded = false;
+	};
+
+	/**
+	* Editors are components, which may only be created on the message thread. Loaded on a loader thread, the plugin
+	* gets no editor until createEditor is called on the message thread.
+	*/
+	bool instantiate()
+	{
+		PluginDescription description;
+
+		if (!parseDescription(xmlPluginDescription.toRawUTF8(), description))
+			return false;
+
+		return host.createInstance(description, sampleRate, bufferSize, !host.headless && MessageManager::existsAndIsCurrentThread());
+	}
+
+	/**
+	* Posts the instantiation to the message thread and waits for it without blocking that thread's owner: if the job is
+	* asked to exit, for example because the host is being destroyed on the message thread, the instantiation is cancelled.
+	* Returns false if it was cancelled.
+	*/
+	bool instantiateOnMessageThread(bool& succeeded)
+	{
+		ReferenceCountedObjectPtr<CreationMessage> message = new CreationMessage(*this);
+		message->post();
+
+		while (!message->finished.wait(20))
+		{
+			if (shouldExit())
+			{
+				// Waits for the message thread if it is creating the instance right now, which it finishes without this thread.
+				const ScopedLock lock(message->cancelLock);
+
+				if (!message->finished.wait(0))
+				{
+					message->cancelled = true;
+					host.instantiationState = instantiationFailed;
+					return false;
+				}
+
+				break;
+			}
+		}
+
+		succeeded = message->succeeded;
+		return true;
+	}
+
+	PluginHost& host;
+	const String xmlPluginDescription;
+	const double sampleRate;
+	const int bufferSize;
+	const InstantiationCallback callback;
+};
 
 /**
 *Constructs a host for a single plugin.
@@ -20,10 +136,29 @@ PluginHost::PluginHost()
 	formatManager->addFormat(new VST3PluginFormat);
 	audioData = new AudioBuffer<float>(1, 512);
 	midiData = new MidiBuffer();
+	pendingEvents.allocate((size_t) parameterEvents.getCapacity(), true);
+
+	// Reserve room for dense note data, so the MIDI buffers don't allocate while processing.
+	const size_t midiBufferBytes = 65536;
+	midiData->ensureSize(midiBufferBytes);
+	midiInput.ensureSize(midiBufferBytes);
+	midiOutput.ensureSize(midiBufferBytes);
+	reblockMidi.ensureSize(midiBufferBytes);
 }
 
 PluginHost::~PluginHost()
 {
+	// Stop a background instantiation before tearing down what it works on.
+	stopInstantiationJob();
+}
+
+/**
+*Chooses wether plugins should be instantiated without an editor. Headless hosts only create an editor when asked with createEditor.
+*@param shouldBeHeadless Wether instantiation should skip creating the editor.
+*/
+void PluginHost::setHeadless(bool shouldBeHeadless)
+{
+	headless = shouldBeHeadless;
 }
 
 /**
@@ -33,33 +168,175 @@ PluginHost::~PluginHost()
  *@param bufferSize The buffer size to initialize plugin with.
  *@return A boolean representing wether instantiation was successful or not.
 */
-bool PluginHost::instantiatePlugin(char* xmlPluginDescription, double sampleRate, int bufferSize)
+bool PluginHost::instantiatePlugin(const char* xmlPluginDescription, double sampleRate, int bufferSize)
 {
-	if (!pluginInstantiated)
+	if (pluginInstantiated)
+		return false;
+
+	PluginDescription description;
+
+	if (!parseDescription(xmlPluginDescription, description))
+		return false;
+
+	return instantiatePlugin(description, sampleRate, bufferSize);
+}
+
+/**
+ *Instantiates a plugin from a description which is already parsed, such as one held by a plugins manager.
+ *@param description The description of the plugin. It is copied.
+ *@param sampleRate The sample rate to initialize plugin with.
+ *@param bufferSize The buffer size to initialize plugin with.
+ *@return A boolean representing wether instantiation was successful or not.
+*/
+bool PluginHost::instantiatePlugin(const PluginDescription& description, double sampleRate, int bufferSize)
+{
+	return createInstance(description, sampleRate, bufferSize, !headless);
+}
+
+/**
+*Starts instantiating a plugin on a background loader thread and returns immediately.
+*Progress can be polled with getInstantiationState, and the host must not be used otherwise until it has finished.
+*Unless the format has to be created on the message thread, the plugin is loaded without an editor, which can be created
+*afterwards with createEditor on the message thread.
+*@param xmlPluginDescription A string containing the XML Document which can be read as a PluginDescription.
+*@param sampleRate The sample rate to initialize plugin with.
+*@param bufferSize The buffer size to initialize plugin with.
+*@param callback A function called from the loader thread once instantiation has finished. May be null.
+*@return A boolean representing wether instantiation was started. Returns false if a plugin is instantiated or being instantiated.
+*/
+bool PluginHost::instantiatePluginAsync(const char* xmlPluginDescription, double sampleRate, int bufferSize, InstantiationCallback callback)
+{
+	if (pluginInstantiated || instantiationState == instantiating)
+		return false;
+
+	// The previous job has finished, but the pool may not have let go of it yet.
+	stopInstantiationJob();
+
+	instantiationState = instantiating;
+	instantiationJob = new InstantiationJob(*this, String(xmlPluginDescription), sampleRate, bufferSize, callback);
+	loaderPool->addJob(instantiationJob, false);
+	return true;
+}
+
+/**
+*Parses an XML Document representing a JUCE PluginDescription.
+*@param xmlPluginDescription A string containing the XML Document.
+*@param description The description to fill in.
+*@return Wether the document could be read as a PluginDescription.
+*/
+bool PluginHost::parseDescription(const char* xmlPluginDescription, PluginDescription& description)
+{
+	XmlDocument document(xmlPluginDescription);
+	ScopedPointer<XmlElement> element = document.getDocumentElement();
+	return element != nullptr && description.loadFromXml(*element);
+}
+
+/**
+*Creates the plugin instance and sets the host up around it.
+*@param description The description of the plugin. It is copied.
+*@param sampleRate The sample rate to initialize plugin with.
+*@param bufferSize The buffer size to initialize plugin with.
+*@param withEditor Wether to create the editor as well. Must only be true on the message thread.
+*@return A boolean representing wether instantiation was successful or not.
+*/
+bool PluginHost::createInstance(const PluginDescription& description, double sampleRate, int bufferSize, bool withEditor)
+{
+	if (pluginInstantiated)
+		return false;
+
+	pluginDescription = new PluginDescription(description);
+	String error = "Could not create plugin instance.";
+	pluginInstance = formatManager->createPluginInstance(*pluginDescription, sampleRate, bufferSize, error);
+
+	if (pluginInstance == nullptr)
+		return false;
+
+	if (withEditor)
+		pluginEditor = pluginInstance->createEditor();
+
+	currentSampleRate = sampleRate;
+	applyProcessingPrecision();
+	allocateProcessingBuffers(bufferSize);
+	parameterNames.build(*pluginInstance);
+	parameterEvents.reset();
+	pluginInstantiated = true;
+	return true;
+}
+
+/**
+*Gets how far instantiation of the plugin has come.
+*@return One of the InstantiationState values.
+*/
+int PluginHost::getInstantiationState()
+{
+	const int state = instantiationState;
+
+	if (state == instantiating)
+		return state;
+
+	return pluginInstantiated ? instantiated : state;
+}
+
+/**
+*Takes the instantiation job out of the loader pool, asking it to exit and waiting until it has. A job waiting for the message
+*thread cancels its instantiation when asked to exit, so this doesn't deadlock when called from the message thread.
+*/
+void PluginHost::stopInstantiationJob()
+{
+	if (instantiationJob == nullptr)
+		return;
+
+	loaderPool->removeJob(instantiationJob, true, -1);
+	instantiationJob = nullptr;
+}
+
+/**
+*Creates the editor of the plugin, if it doesn't exist yet. Editors are components, so this must be called on the message thread.
+*@return A boolean representing wether the plugin has an editor. Returns false if plugin is not instantiated or has no editor.
+*/
+bool PluginHost::createEditor()
+{
+	const ScopedReadLock lock(instanceLock);
+
+	if (pluginInstantiated)
 	{
-		pluginDescription = new PluginDescription();
-		ScopedPointer<XmlDocument> document = new XmlDocument(xmlPluginDescription);
-		XmlElement* element = document->getDocumentElement();
-		
-		if (pluginDescription->loadFromXml(*element))
-		{
-			String error = "Could not create plugin instance.";
-			pluginInstance = formatManager->createPluginInstance(*pluginDescription, sampleRate, bufferSize, error);
+		if (pluginEditor == nullptr)
+			pluginEditor = pluginInstance->createEditor();
 
-			if (pluginInstance)
-			{
-				pluginEditor = pluginInstance->createEditor();
-				pluginInstantiated = true;
-				return true;
-			}
-		}
+		return pluginEditor != nullptr;
 	}
 
 	return false;
 }
 
 /**
-*Prepares the plugin instance for playback.
+*Deletes the editor of the plugin, if there is one. Components may only be deleted on the message thread,
+*so when called from another thread this waits until the message thread has deleted it.
+*/
+void PluginHost::closeEditor()
+{
+	if (pluginEditor == nullptr)
+		return;
+
+	MessageManager* messageManager = MessageManager::getInstanceWithoutCreating();
+
+	if (messageManager == nullptr || messageManager->isThisTheMessageThread())
+		pluginEditor = nullptr;
+	else
+		messageManager->callFunctionOnMessageThread(deleteEditorOnMessageThread, this);
+}
+
+/**
+*Deletes the editor of a host. Called on the message thread by closeEditor.
+*/
+void* PluginHost::deleteEditorOnMessageThread(void* host)
+{
+	static_cast<PluginHost*>(host)->pluginEditor = nullptr;
+	return nullptr;
+}
+
+/**
+*Prepares the plugin instance for playback. While re-blocking, the plugin is prepared with its fixed block size instead.
 *@param sampleRate The sample rate to initialize plugin with.
 *@param expectedSamplesPerBlock The maximum buffer size to expect.
 */
@@ -67,8 +344,17 @@ void PluginHost::prepareToPlay(double sampleRate, int expectedSamplesPerBlock)
 {
 	if (pluginInstantiated)
 	{
-		pluginInstance->setRateAndBufferSizeDetails(sampleRate, expectedSamplesPerBlock);
-		pluginInstance->prepareToPlay(sampleRate, expectedSamplesPerBlock);
+		const int pluginBlockSize = reblockSize > 0 ? reblockSize : expectedSamplesPerBlock;
+
+		dropShadowInstance();
+		currentSampleRate = sampleRate;
+		pluginInstance->setRateAndBufferSizeDetails(sampleRate, pluginBlockSize);
+		pluginInstance->prepareToPlay(sampleRate, pluginBlockSize);
+		allocateProcessingBuffers(pluginBlockSize);
+		resetReblocking();
+
+		if (!presetBank.isEmpty())
+			prepareShadowInstance();
 	}
 }
 
@@ -79,6 +365,8 @@ void PluginHost::prepareToPlay(double sampleRate, int expectedSamplesPerBlock)
  */
 bool PluginHost::suspendPlugin(bool shouldBeSuspended)
 {
+	const ScopedReadLock lock(instanceLock);
+
 	if (pluginInstantiated)
 	{
 		pluginInstance->suspendProcessing(shouldBeSuspended);
@@ -88,194 +376,866 @@ bool PluginHost::suspendPlugin(bool shouldBeSuspended)
 }
 
 /**
-*Releases and deletes the plugin instance.
-*@return A boolean representing wether the instance was successfully released.
+*Tells the plugin wether it is rendering offline, which lets it trade speed for quality.
+*@param isNonRealtime Wether processing is offline.
+*@return A boolean representing wether the mode was changed. Returns false if plugin is not instantiated.
 */
-bool PluginHost::releasePlugin()
+bool PluginHost::setNonRealtime(bool isNonRealtime)
 {
+	const ScopedReadLock lock(instanceLock);
+
 	if (pluginInstantiated)
 	{
-		// TODO: Might need to manually delete editor
-		delete pluginInstance;
-		pluginInstantiated = false;
+		pluginInstance->setNonRealtime(isNonRealtime);
 		return true;
 	}
 	return false;
 }
 
 /**
-*Processes a block of audio with plugin. If the plugin is not instantiated, the buffer won't be changed.
-*@param buffer A buffer of floats containing audio data to be processed.
-*@param bufferLength The length of the buffer in samples.
-*@param numChannels The total number of channels contained in buffer.
+*Releases the resources of the plugin and clears its internal state, such as reverb tails, ready to be prepared for new material.
+*@return A boolean representing wether the plugin was reset. Returns false if plugin is not instantiated.
 */
-void PluginHost::processBlock(float* buffer, int bufferLength, int numChannels)
+bool PluginHost::resetPlugin()
 {
 	if (pluginInstantiated)
 	{
-		audioData = new AudioBuffer<float>(&buffer, numChannels, bufferLength);
-		//audioData->setDataToReferTo(&buffer, numChannels, bufferLength);
-		pluginInstance->processBlock(*audioData, *midiData);
+		pluginInstance->releaseResources();
+		pluginInstance->reset();
+		resetReblocking();
+		return true;
 	}
+	return false;
 }
 
 /**
-*Gets the total number of inputs on plugin.
-*@return The number of input channels. Returns 0 if plugin is not instantiated.
+*Puts the host back into its default modes without preparing the plugin again: single precision, no re-blocking,
+*realtime and not suspended, with an empty preset bank and no preset switch pending. The plugin is left released,
+*so it can be prepared once for its next use. Must not be called while processing.
+*@return A boolean representing wether the modes were reset. Returns false if plugin is not instantiated.
 */
-int PluginHost::getNumInputs()
+bool PluginHost::resetModes()
 {
 	if (pluginInstantiated)
-		return pluginInstance->getTotalNumInputChannels();
-	else
-		return 0;
+	{
+		dropShadowInstance();
+		presetBank.clear();
+		pluginInstance->releaseResources();
+		pluginInstance->suspendProcessing(false);
+		pluginInstance->setNonRealtime(false);
+		reblockSize = 0;
+		doublePrecisionRequested = false;
+		applyProcessingPrecision();
+		return true;
+	}
+	return false;
 }
 
 /**
-*Gets the total number of outputs on plugin.
-*@return The number of output channels. Returns 0 if plugin is not instantiated.
+*Captures the state of the plugin and gets its size, for sizing the buffer passed to getState.
+*The captured state is kept until the next call to getState, so it isn't captured twice, unless the state is changed through
+*the host in between.
+*@param currentProgramOnly Wether to capture only the state of the current program instead of the whole plugin.
+*@return The size of the state in bytes. Returns 0 if plugin is not instantiated.
 */
-int PluginHost::getNumOutputs()
+int PluginHost::getStateSize(bool currentProgramOnly)
 {
-	if (pluginInstantiated)
-		return pluginInstance->getTotalNumOutputChannels();
-	else
-		return 0;
-}
+	const ScopedReadLock lock(instanceLock);
 
-/**
-*Gets the total number of parameters on plugin.
-*@return The number of parameters. Returns 0 if plugin is not instantiated.
-*/
-int PluginHost::getNumParameters()
-{
 	if (pluginInstantiated)
 	{
-		return pluginInstance->getNumParameters();
+		const ScopedLock snapshotLock(stateSnapshotLock);
+		captureState(currentProgramOnly);
+		return (int) stateSnapshot.getSize();
 	}
-	else
-		return 0;
+	return 0;
 }
 
 /**
-*Gets the total number of managed parameters (defined by plugin) on plugin.
-*@return The number of parameters. Returns 0 if plugin is not instantiated or no managed parameters exist.
+*Copies the state of the plugin into a caller-owned buffer. If getStateSize was called before, the state it captured is copied,
+*otherwise the state is captured now. A state which didn't fit is kept for the next call. Setting the state, parameters or
+*preset through the host in between throws the captured state away, so the size returned may then differ from getStateSize.
+*@param out The buffer to copy the state into. If null or too small, nothing is written.
+*@param capacity The number of bytes out can hold.
+*@param currentProgramOnly Wether to capture only the state of the current program instead of the whole plugin.
+*@return The size of the state in bytes, which may be larger than capacity. Returns 0 if plugin is not instantiated.
 */
-int PluginHost::getNumNamedParameters()
+int PluginHost::getState(void* out, int capacity, bool currentProgramOnly)
 {
+	const ScopedReadLock lock(instanceLock);
+
 	if (pluginInstantiated)
 	{
-		for (int i = 0; i < getNumParameters(); i++)
+		const ScopedLock snapshotLock(stateSnapshotLock);
+
+		if (!stateSnapshotPending || stateSnapshotIsProgram != currentProgramOnly)
+			captureState(currentProgramOnly);
+
+		const int size = (int) stateSnapshot.getSize();
+
+		if (out != nullptr && capacity >= size)
 		{
-			if (getParameterName(i) == "Bypass" || getParameterName(i) == "")
-			{
-				return i;
-			}
+			stateSnapshot.copyTo(out, 0, (size_t) size);
+
+			// States of sampler plugins can be tens of megabytes, so don't hold on to them.
+			stateSnapshot.reset();
+			stateSnapshotPending = false;
 		}
+
+		return size;
 	}
-	
 	return 0;
 }
 
 /**
-*Gets the name of a plugin parameter at a given index.
-*@param index The parameter index from which to get name.
-*@return The name of the parameter as const char*. If plugin or parameter does not exist, nullptr is returned.
+*Restores the state of the plugin from a binary blob created by getState. The blob is handed to the plugin without copying.
+*@param data The state data.
+*@param size The size of data in bytes.
+*@param currentProgramOnly Wether data holds only the state of the current program instead of the whole plugin.
+*@return A boolean representing wether the state was handed to the plugin. Returns false if plugin is not instantiated.
 */
-String PluginHost::getParameterName(int index)
+bool PluginHost::setState(const void* data, int size, bool currentProgramOnly)
 {
-	if (pluginInstantiated)
+	const ScopedReadLock lock(instanceLock);
+
+	if (pluginInstantiated && data != nullptr && size > 0)
 	{
-		if (index >= 0 && index < getNumParameters())
-			return pluginInstance->getParameterName(index);
-	}
+		invalidateStateSnapshot();
 
-	return "";
+		if (currentProgramOnly)
+			pluginInstance->setCurrentProgramStateInformation(data, size);
+		else
+			pluginInstance->setStateInformation(data, size);
+
+		return true;
+	}
+	return false;
 }
 
 /**
-*Gets the value of a parameter with a given name.
-*@param name The name of the parameter to get value of.
-*@return The value of the parameter as float. If plugin or parameter does not exist, 0f is returned.
+*Stores a preset in the bank of the host, ready to be switched to without decoding.
+*@param data A binary state blob created by getState.
+*@param size The size of data in bytes.
+*@param currentProgramOnly Wether data holds only the state of the current program instead of the whole plugin.
+*@return The index of the preset in the bank. If plugin is not instantiated or data is empty, -1 is returned.
 */
-float PluginHost::getValueByName(char* name)
+int PluginHost::addPresetToBank(const void* data, int size, bool currentProgramOnly)
 {
-	if (pluginInstantiated)
+	if (pluginInstantiated && data != nullptr && size > 0)
 	{
-		String nameToFind = String(name);
-		for (int i = 0; i < getNumNamedParameters(); i++)
-		{
-			if (getParameterName(i) == nameToFind)
-			{
-				return getValueByIndex(i);
-			}
-		}
-	}
+		auto* preset = new BankedPreset();
+		preset->state.append(data, (size_t) size);
+		preset->currentProgramOnly = currentProgramOnly;
+		presetBank.add(preset);
 
-	return 0.0f;
+		// Have the shadow instance ready before the first switch.
+		if (presetSwapState == swapIdle)
+			prepareShadowInstance();
+
+		return presetBank.size() - 1;
+	}
+	return -1;
 }
 
 /**
-*Sets the value of a parameter with a given name.
-*@param name The name of the parameter whose value to set.
-*@param value The value to set.
-*@return Wether setting value succeeded. If plugin or parameter does not exist, false is returned.
+*Removes all presets from the bank, along with the shadow instance kept for switching to them. Must not be called while switching presets.
 */
-bool PluginHost::setValueByName(char* name, float value)
+void PluginHost::clearPresetBank()
 {
-	if (pluginInstantiated)
+	if (presetSwapState == swapIdle)
 	{
-		String nameToFind = String(name);
-		for (int i = 0; i < getNumNamedParameters(); i++)
-		{
-			if (getParameterName(i) == nameToFind)
-			{
-				setValueByIndex(i, value);
-				return true;
-			}
-		}
+		presetBank.clear();
+		dropShadowInstance();
 	}
-	return false;
 }
 
 /**
-*Gets the value of a parameter with a given index.
-*@param index The index of the parameter to get value of.
-*@return The value of the parameter as float. If plugin or parameter does not exist, 0f is returned.
+*Gets the number of presets in the bank.
+*@return The number of presets.
 */
-float PluginHost::getValueByIndex(int index)
+int PluginHost::getNumBankPresets()
 {
-	if (pluginInstantiated)
-	{
-		if (index >= 0 && index < getNumParameters())
-		{
-			return pluginInstance->getParameter(index);
-		}
-	}
+	return presetBank.size();
+}
 
-	return 0.0f;
+/**
+*Switches to a preset from the bank without interrupting the audio. The preset is loaded into a shadow instance on the
+*calling thread, which the audio thread swaps in at the start of its next block and crossfades to.
+*The editor shows the instance being switched away from, so it is closed on the message thread and has to be created again.
+*@param index The index of the preset in the bank.
+*@param crossfadeSamples The length of the crossfade from the current instance to the new one, in samples.
+*@return Wether the switch was started. Returns false if plugin is not instantiated, the index is invalid or a switch is still in progress.
+*/
+bool PluginHost::switchToPreset(int index, int crossfadeSamples)
+{
+	if (!pluginInstantiated || !isPositiveAndBelow(index, presetBank.size()) || presetSwapState != swapIdle)
+		return false;
+
+	if (!prepareShadowInstance())
+		return false;
+
+	const BankedPreset& preset = *presetBank.getUnchecked(index);
+
+	if (preset.currentProgramOnly)
+		shadowInstance->setCurrentProgramStateInformation(preset.state.getData(), (int) preset.state.getSize());
+	else
+		shadowInstance->setStateInformation(preset.state.getData(), (int) preset.state.getSize());
+
+	// The shadow may be the instance switched away from last time, so clear its tails.
+	shadowInstance->reset();
+
+	// The editor belongs to the instance being switched away from.
+	closeEditor();
+	invalidateStateSnapshot();
+
+	pendingCrossfadeSamples = jmax(0, crossfadeSamples);
+	presetSwapState.store(swapPending, std::memory_order_release);
+	return true;
 }
 
 /**
-*Sets the value of a parameter with a given index.
-*@param index The index of the parameter to whose value to set.
-*@param value The value to set.
-*@return Wether setting value succeeded. If plugin or parameter does not exist, false is returned.
+*Checks wether a preset switch has been started and not yet completed by the audio thread.
+*@return Wether a switch is in progress.
 */
-bool PluginHost::setValueByIndex(int index, float value)
+bool PluginHost::isSwitchingPreset()
+{
+	return presetSwapState.load(std::memory_order_acquire) != swapIdle;
+}
+
+/**
+*Releases and deletes the plugin instance. The preset bank is cleared too, as its states belong to this plugin.
+*@return A boolean representing wether the instance was successfully released.
+*/
+bool PluginHost::releasePlugin()
 {
 	if (pluginInstantiated)
 	{
-		if (index >= 0 && index < getNumParameters())
-		{
-			pluginInstance->setParameter(index, value);
-			return true;
-		}
+		// The editor refers to the instance, so it has to go first.
+		pluginEditor = nullptr;
+		dropShadowInstance();
+		presetBank.clear();
+		pluginInstance = nullptr;
+		parameterNames.clear();
+		invalidateStateSnapshot();
+		pluginInstantiated = false;
+		instantiationState = notInstantiated;
+		return true;
 	}
-
 	return false;
 }
 
+/**
+*Processes a block of audio with plugin. If the plugin is not instantiated, the buffer won't be changed.
+*@param buffer A buffer of floats containing planar audio data to be processed, one channel after another.
+*@param bufferLength The length of each channel in samples.
+*@param numChannels The total number of channels contained in buffer.
+*/
+void PluginHost::processBlock(float* buffer, int bufferLength, int numChannels)
+{
+	if (pluginInstantiated && buffer != nullptr)
+	{
+		// Channels beyond what the plugin uses are passed through untouched.
+		const int numChannelsToProcess = jmin(numChannels, numPluginChannels);
+
+		for (int channel = 0; channel < numChannelsToProcess; channel++)
+			planarPointers[channel] = buffer + channel * bufferLength;
+
+		processBlockPlanar(planarPointers, numChannelsToProcess, bufferLength);
+	}
+}
+
+/**
+*Processes a block of planar audio with plugin without allocating. If the plugin is not instantiated, the buffers won't be changed.
+*Channels the plugin expects but the caller doesn't provide are fed with silence. The block is split at scheduled
+*parameter changes and wherever it exceeds the prepared block size.
+*@param channels An array of pointers to the audio data of each channel.
+*@param numChannels The number of channel pointers in channels.
+*@param numSamples The number of samples in each channel.
+*/
+void PluginHost::processBlockPlanar(float** channels, int numChannels, int numSamples)
+{
+	if (pluginInstantiated && channels != nullptr && maxSamplesPerBlock > 0)
+	{
+		beginPresetSwap();
+		beginParameterEvents();
+		renderPlanar(channels, numChannels, numSamples, 0);
+		applyParameterEvents(std::numeric_limits<int>::max());
+	}
+}
+
+/**
+*Processes a block of interleaved audio with plugin in place. If the plugin is not instantiated, the buffer won't be changed.
+*Frames are split into preallocated planar scratch, processed and merged back. Channels beyond what the plugin uses are left untouched.
+*@param buffer A buffer of floats containing interleaved audio frames to be processed.
+*@param numFrames The number of frames in buffer.
+*@param numChannels The number of channels in each frame.
+*/
+void PluginHost::processBlockInterleaved(float* buffer, int numFrames, int numChannels)
+{
+	if (pluginInstantiated && buffer != nullptr && maxSamplesPerBlock > 0)
+	{
+		const int numChannelsToProcess = jmin(numChannels, numPluginChannels);
+		float** scratch = interleavedScratch.getArrayOfWritePointers();
+		beginPresetSwap();
+		beginParameterEvents();
+
+		for (int offset = 0; offset < numFrames; offset += maxSamplesPerBlock)
+		{
+			const int blockLength = jmin(numFrames - offset, maxSamplesPerBlock);
+			float* frames = buffer + offset * numChannels;
+
+			InterleavedAudio::deinterleave(frames, numChannels, scratch, numChannelsToProcess, blockLength);
+			renderPlanar(scratch, numChannelsToProcess, blockLength, offset);
+			InterleavedAudio::interleave(scratch, numChannelsToProcess, frames, numChannels, blockLength);
+		}
+
+		applyParameterEvents(std::numeric_limits<int>::max());
+	}
+}
+
+/**
+*Processes a block of planar double precision audio with plugin. If the plugin is not instantiated, the buffers won't be changed.
+*Plugins processing in double precision get the audio directly; for other plugins it is converted to single precision and back.
+*@param channels An array of pointers to the audio data of each channel.
+*@param numChannels The number of channel pointers in channels.
+*@param numSamples The number of samples in each channel.
+*/
+void PluginHost::processBlockDouble(double** channels, int numChannels, int numSamples)
+{
+	if (pluginInstantiated && channels != nullptr && maxSamplesPerBlock > 0)
+	{
+		beginPresetSwap();
+		beginParameterEvents();
+
+		if (reblockSize > 0)
+		{
+			// The re-blocking FIFO holds single precision audio, so convert around it.
+			const int numChannelsToProcess = jmin(numChannels, numPluginChannels);
+			float** converted = floatConversion.getArrayOfWritePointers();
+
+			for (int offset = 0; offset < numSamples; offset += maxSamplesPerBlock)
+			{
+				const int blockLength = jmin(numSamples - offset, maxSamplesPerBlock);
+
+				for (int channel = 0; channel < numChannelsToProcess; channel++)
+					PrecisionConversion::toFloat(channels[channel] + offset, converted[channel], blockLength);
+
+				reblock(converted, numChannelsToProcess, blockLength, offset);
+
+				for (int channel = 0; channel < numChannelsToProcess; channel++)
+					PrecisionConversion::toDouble(converted[channel], channels[channel] + offset, blockLength);
+			}
+		}
+		else
+		{
+			renderSegments(channels, numChannels, numSamples, 0);
+		}
+
+		applyParameterEvents(std::numeric_limits<int>::max());
+	}
+}
+
+/**
+*Processes a block of planar audio with plugin while feeding it MIDI events, and returns the MIDI it produces.
+*Events are copied into preallocated MIDI buffers, so dense note data doesn't allocate. Events after the end of the block are played on its last sample.
+*@param channels An array of pointers to the audio data of each channel.
+*@param numChannels The number of channel pointers in channels.
+*@param numSamples The number of samples in each channel.
+*@param events An array of events to send to the plugin.
+*@param numEvents The number of events in events.
+*@param sysExData A blob holding the SysEx messages referenced by events. May be null if there are none.
+*@param sysExSize The size of sysExData in bytes.
+*@param outputEvents An array receiving the events produced by the plugin. May be null.
+*@param outputCapacity The number of events outputEvents can hold.
+*@param outputSysExData A blob receiving SysEx messages produced by the plugin. May be null.
+*@param outputSysExCapacity The number of bytes outputSysExData can hold.
+*@return The number of events written to outputEvents. Events which don't fit are dropped. Returns 0 if plugin is not instantiated.
+*/
+int PluginHost::processBlockWithMidi(float** channels, int numChannels, int numSamples, const PackedMidiEvent* events, int numEvents,
+									 const uint8* sysExData, int sysExSize, PackedMidiEvent* outputEvents, int outputCapacity,
+									 uint8* outputSysExData, int outputSysExCapacity)
+{
+	if (!pluginInstantiated || channels == nullptr || maxSamplesPerBlock <= 0 || numSamples <= 0)
+		return 0;
+
+	midiInput.clear();
+
+	for (int i = 0; events != nullptr && i < numEvents; i++)
+	{
+		const PackedMidiEvent& event = events[i];
+		const int sampleOffset = jlimit(0, numSamples - 1, (int) event.sampleOffset);
+
+		if (event.sysExOffset >= 0)
+		{
+			// Compared without adding, so offsets and sizes near the int32 limit can't overflow past the check.
+			if (sysExData != nullptr && event.size > 0 && event.sysExOffset <= sysExSize && event.size <= sysExSize - event.sysExOffset)
+				midiInput.addEvent(sysExData + event.sysExOffset, event.size, sampleOffset);
+		}
+		else if (event.size >= 1 && event.size <= 3)
+		{
+			midiInput.addEvent(event.bytes, event.size, sampleOffset);
+		}
+	}
+
+	midiOutput.clear();
+	collectingMidiOutput = true;
+	processBlockPlanar(channels, numChannels, numSamples);
+	collectingMidiOutput = false;
+	midiInput.clear();
+
+	MidiBuffer::Iterator iterator(midiOutput);
+	const uint8* data;
+	int size;
+	int position;
+	int numWritten = 0;
+	int sysExWritten = 0;
+
+	while (outputEvents != nullptr && numWritten < outputCapacity && iterator.getNextEvent(data, size, position))
+	{
+		PackedMidiEvent& event = outputEvents[numWritten];
+
+		if (size <= 3)
+		{
+			event.sysExOffset = -1;
+			std::memcpy(event.bytes, data, (size_t) size);
+		}
+		else if (outputSysExData != nullptr && size <= outputSysExCapacity - sysExWritten)
+		{
+			event.sysExOffset = sysExWritten;
+			std::memcpy(outputSysExData + sysExWritten, data, (size_t) size);
+			sysExWritten += size;
+		}
+		else
+		{
+			continue;
+		}
+
+		event.sampleOffset = position;
+		event.size = size;
+		numWritten++;
+	}
+
+	return numWritten;
+}
+
+/**
+*Chooses wether plugin should process in double precision. Only takes effect for plugins supporting it; other plugins
+*keep processing in single precision. Can be set before instantiation, otherwise the plugin is released, switched and prepared
+*again, as plugins only pick up their precision while being prepared.
+*@param shouldUseDoublePrecision Wether plugin should process in double precision.
+*@return Wether plugin now processes in double precision. Returns false if plugin is not instantiated.
+*/
+bool PluginHost::setDoublePrecision(bool shouldUseDoublePrecision)
+{
+	doublePrecisionRequested = shouldUseDoublePrecision;
+
+	if (pluginInstantiated)
+	{
+		pluginInstance->releaseResources();
+		applyProcessingPrecision();
+		prepareToPlay(currentSampleRate, maxSamplesPerBlock);
+	}
+
+	return processingInDouble;
+}
+
+/**
+*Switches re-blocking on or off. While re-blocking, audio of any length is collected in a FIFO and the plugin
+*always processes blocks of one fixed size, which delays the output by that block size. The plugin is released and prepared
+*again, so it sets itself up for the new block size.
+*@param shouldReblock Wether audio should be re-blocked.
+*@param pluginBlockSize The fixed number of samples the plugin processes at once.
+*@return Wether the mode was changed. If plugin is not instantiated or the block size is not positive, false is returned.
+*/
+bool PluginHost::setReblocking(bool shouldReblock, int pluginBlockSize)
+{
+	if (pluginInstantiated && (pluginBlockSize > 0 || !shouldReblock))
+	{
+		const int blockSize = shouldReblock ? pluginBlockSize : maxSamplesPerBlock;
+
+		reblockSize = shouldReblock ? pluginBlockSize : 0;
+		pluginInstance->releaseResources();
+		prepareToPlay(currentSampleRate, blockSize);
+		return true;
+	}
+
+	return false;
+}
+
+/**
+*Gets the latency added by the host itself, on top of the latency reported by plugin.
+*@return The latency in samples. Returns 0 unless re-blocking.
+*/
+int PluginHost::getHostLatencySamples()
+{
+	return reblockSize;
+}
+
+/**
+*Gets the total number of inputs on plugin.
+*@return The number of input channels. Returns 0 if plugin is not instantiated.
+*/
+int PluginHost::getNumInputs()
+{
+	const ScopedReadLock lock(instanceLock);
+
+	if (pluginInstantiated)
+		return pluginInstance->getTotalNumInputChannels();
+	else
+		return 0;
+}
+
+/**
+*Gets the total number of outputs on plugin.
+*@return The number of output channels. Returns 0 if plugin is not instantiated.
+*/
+int PluginHost::getNumOutputs()
+{
+	const ScopedReadLock lock(instanceLock);
+
+	if (pluginInstantiated)
+		return pluginInstance->getTotalNumOutputChannels();
+	else
+		return 0;
+}
+
+/**
+*Gets the processing latency reported by plugin.
+*@return The latency in samples. Returns 0 if plugin is not instantiated.
+*/
+int PluginHost::getLatencySamples()
+{
+	const ScopedReadLock lock(instanceLock);
+
+	if (pluginInstantiated)
+		return pluginInstance->getLatencySamples();
+	else
+		return 0;
+}
+
+/**
+*Gets the total number of parameters on plugin.
+*@return The number of parameters. Returns 0 if plugin is not instantiated.
+*/
+int PluginHost::getNumParameters()
+{
+	const ScopedReadLock lock(instanceLock);
+
+	if (pluginInstantiated)
+	{
+		return pluginInstance->getNumParameters();
+	}
+	else
+		return 0;
+}
+
+/**
+*Gets the total number of managed parameters (defined by plugin) on plugin.
+*Managed parameters are the ones preceding the first parameter called "Bypass" or without a name, counted when the plugin was instantiated.
+*@return The number of parameters. Returns 0 if plugin is not instantiated or no managed parameters exist.
+*/
+int PluginHost::getNumNamedParameters()
+{
+	if (pluginInstantiated)
+		return parameterNames.getNumNamedParameters();
+
+	return 0;
+}
+
+/**
+*Gets the name of a plugin parameter at a given index.
+*@param index The parameter index from which to get name.
+*@return The name of the parameter as const char*. If plugin or parameter does not exist, nullptr is returned.
+*/
+String PluginHost::getParameterName(int index)
+{
+	const ScopedReadLock lock(instanceLock);
+
+	if (pluginInstantiated)
+	{
+		if (index >= 0 && index < getNumParameters())
+			return pluginInstance->getParameterName(index);
+	}
+
+	return "";
+}
+
+/**
+*Gets the index of a managed parameter with a given name, without allocating.
+*@param name The name of the parameter to find.
+*@return The index of the parameter. If plugin or parameter does not exist, -1 is returned.
+*/
+int PluginHost::getParameterIndex(char* name)
+{
+	if (pluginInstantiated)
+		return parameterNames.getIndex(name);
+
+	return -1;
+}
+
+/**
+*Gets the value of a parameter with a given name.
+*@param name The name of the parameter to get value of.
+*@return The value of the parameter as float. If plugin or parameter does not exist, 0f is returned.
+*/
+float PluginHost::getValueByName(char* name)
+{
+	const int index = getParameterIndex(name);
+
+	if (index >= 0)
+		return getValueByIndex(index);
+
+	return 0.0f;
+}
+
+/**
+*Sets the value of a parameter with a given name.
+*@param name The name of the parameter whose value to set.
+*@param value The value to set.
+*@return Wether setting value succeeded. If plugin or parameter does not exist, false is returned.
+*/
+bool PluginHost::setValueByName(char* name, float value)
+{
+	const int index = getParameterIndex(name);
+
+	if (index >= 0)
+		return setValueByIndex(index, value);
+
+	return false;
+}
+
+/**
+*Gets the value of a parameter with a given index.
+*@param index The index of the parameter to get value of.
+*@return The value of the parameter as float. If plugin or parameter does not exist, 0f is returned.
+*/
+float PluginHost::getValueByIndex(int index)
+{
+	const ScopedReadLock lock(instanceLock);
+
+	if (pluginInstantiated)
+	{
+		if (index >= 0 && index < getNumParameters())
+		{
+			return pluginInstance->getParameter(index);
+		}
+	}
+
+	return 0.0f;
+}
+
+/**
+*Sets the value of a parameter with a given index.
+*@param index The index of the parameter to whose value to set.
+*@param value The value to set.
+*@return Wether setting value succeeded. If plugin or parameter does not exist, false is returned.
+*/
+bool PluginHost::setValueByIndex(int index, float value)
+{
+	const ScopedReadLock lock(instanceLock);
+
+	if (pluginInstantiated)
+	{
+		if (index >= 0 && index < getNumParameters())
+		{
+			invalidateStateSnapshot();
+			pluginInstance->setParameter(index, value);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+*Gets the values of several parameters in one call.
+*@param indices An array of parameter indices to get values of.
+*@param values An array of at least count floats which receives the values. Values of parameters that don't exist are set to 0f.
+*@param count The number of entries in indices.
+*@return The number of values successfully read. If plugin is not instantiated, 0 is returned.
+*/
+int PluginHost::getValuesByIndex(const int* indices, float* values, int count)
+{
+	const ScopedReadLock lock(instanceLock);
+
+	int numRead = 0;
+
+	if (pluginInstantiated && indices != nullptr && values != nullptr)
+	{
+		const int numParameters = getNumParameters();
+
+		for (int i = 0; i < count; i++)
+		{
+			const int index = indices[i];
+
+			if (index >= 0 && index < numParameters)
+			{
+				values[i] = pluginInstance->getParameter(index);
+				numRead++;
+			}
+			else
+			{
+				values[i] = 0.0f;
+			}
+		}
+	}
+
+	return numRead;
+}
+
+/**
+*Sets the values of several parameters in one call.
+*@param indices An array of parameter indices whose values to set.
+*@param values An array of values to set, matching indices.
+*@param count The number of entries in indices and values.
+*@return The number of values successfully set. Parameters that don't exist are skipped.
+*/
+int PluginHost::setValuesByIndex(const int* indices, const float* values, int count)
+{
+	const ScopedReadLock lock(instanceLock);
+
+	int numWritten = 0;
+
+	if (pluginInstantiated && indices != nullptr && values != nullptr)
+	{
+		const int numParameters = getNumParameters();
+		invalidateStateSnapshot();
+
+		for (int i = 0; i < count; i++)
+		{
+			const int index = indices[i];
+
+			if (index >= 0 && index < numParameters)
+			{
+				pluginInstance->setParameter(index, values[i]);
+				numWritten++;
+			}
+		}
+	}
+
+	return numWritten;
+}
+
+/**
+*Takes a snapshot of the values of all parameters on plugin.
+*@param values An array of floats which receives the value of each parameter in index order.
+*@param capacity The number of floats values can hold.
+*@return The total number of parameters on plugin, which may exceed capacity. Returns 0 if plugin is not instantiated.
+*/
+int PluginHost::getAllValues(float* values, int capacity)
+{
+	const ScopedReadLock lock(instanceLock);
+
+	if (pluginInstantiated)
+	{
+		const int numParameters = getNumParameters();
+
+		if (values != nullptr)
+		{
+			const int numToRead = jmin(numParameters, capacity);
+
+			for (int index = 0; index < numToRead; index++)
+				values[index] = pluginInstance->getParameter(index);
+		}
+
+		return numParameters;
+	}
+
+	return 0;
+}
+
+/**
+*Schedules a parameter change to land at a given sample within the next processed block.
+*Can be called from any thread while audio is processed; the change is applied by the audio thread.
+*@param index The index of the parameter whose value to set.
+*@param value The value to set.
+*@param sampleOffset The sample within the next processed block at which the change should land. Offsets beyond the block are applied at its end.
+*@return Wether the change was scheduled. If plugin or parameter does not exist, or too many changes are waiting, false is returned.
+*/
+bool PluginHost::scheduleValueByIndex(int index, float value, int sampleOffset)
+{
+	if (pluginInstantiated)
+	{
+		if (index >= 0 && index < getNumParameters())
+		{
+			invalidateStateSnapshot();
+			return parameterEvents.push({ jmax(0, sampleOffset), index, value });
+		}
+	}
+
+	return false;
+}
+
+/**
+*Discards parameter changes which were scheduled but not yet applied, so they can't land in a later block.
+*Must not be called while processing or while another thread schedules values.
+*/
+void PluginHost::clearScheduledValues()
+{
+	parameterEvents.reset();
+	numPendingEvents = 0;
+	nextPendingEvent = 0;
+}
+
+/**
+*Describes all parameters on plugin in one call. Nothing is written unless both buffers are large enough,
+*so callers can pass null buffers first to learn the sizes needed.
+*@param infos An array receiving one ParameterInfo per parameter in index order.
+*@param capacity The number of entries infos can hold.
+*@param strings A buffer receiving the names and labels referenced by infos.
+*@param stringCapacity The number of bytes strings can hold.
+*@param requiredStringSize Receives the number of bytes needed for strings. May be null.
+*@return The total number of parameters on plugin. Returns 0 if plugin is not instantiated.
+*/
+int PluginHost::getParameterInfoTable(ParameterInfo* infos, int capacity, char* strings, int stringCapacity, int* requiredStringSize)
+{
+	const ScopedReadLock lock(instanceLock);
+
+	if (!pluginInstantiated)
+	{
+		if (requiredStringSize != nullptr)
+			*requiredStringSize = 0;
+
+		return 0;
+	}
+
+	const int numParameters = getNumParameters();
+	int stringSize = 0;
+
+	for (int index = 0; index < numParameters; index++)
+	{
+		stringSize += (int) pluginInstance->getParameterName(index).toUTF8().sizeInBytes();
+		stringSize += (int) pluginInstance->getParameterLabel(index).toUTF8().sizeInBytes();
+	}
+
+	if (requiredStringSize != nullptr)
+		*requiredStringSize = stringSize;
+
+	if (infos == nullptr || strings == nullptr || capacity < numParameters || stringCapacity < stringSize)
+		return numParameters;
+
+	int stringOffset = 0;
+
+	for (int index = 0; index < numParameters; index++)
+	{
+		ParameterInfo& info = infos[index];
+		info.index = index;
+		info.defaultValue = pluginInstance->getParameterDefaultValue(index);
+		info.value = pluginInstance->getParameter(index);
+		info.numSteps = pluginInstance->getParameterNumSteps(index);
+		info.flags = (pluginInstance->isParameterAutomatable(index) ? ParameterInfo::automatable : 0)
+				   | (pluginInstance->isMetaParameter(index) ? ParameterInfo::metaParameter : 0);
+
+		info.nameOffset = stringOffset;
+		stringOffset += (int) pluginInstance->getParameterName(index).copyToUTF8(strings + stringOffset, (size_t) (stringCapacity - stringOffset));
+
+		info.labelOffset = stringOffset;
+		stringOffset += (int) pluginInstance->getParameterLabel(index).copyToUTF8(strings + stringOffset, (size_t) (stringCapacity - stringOffset));
+	}
+
+	return numParameters;
+}
+
 /**
 *Gets a reference to a parameter with a given name.
 *@param name The name of the parameter to get.
@@ -299,3 +1259,447 @@ AudioProcessorParameter* PluginHost::getParameterByName(char* name)
 
 	return nullptr;
 }
+
+/**
+*Lets the plugin write its state into the snapshot block, where it is kept until it has been copied out.
+*Must be called with the snapshot locked.
+*@param currentProgramOnly Wether to capture only the state of the current program.
+*/
+void PluginHost::captureState(bool currentProgramOnly)
+{
+	stateSnapshot.reset();
+	stateSnapshotPending = true;
+	stateSnapshotIsProgram = currentProgramOnly;
+
+	if (currentProgramOnly)
+		pluginInstance->getCurrentProgramStateInformation(stateSnapshot);
+	else
+		pluginInstance->getStateInformation(stateSnapshot);
+}
+
+/**
+*Throws away a state captured by getStateSize, as the state of the plugin is about to change, so getState captures it again.
+*/
+void PluginHost::invalidateStateSnapshot()
+{
+	const ScopedLock snapshotLock(stateSnapshotLock);
+	stateSnapshot.reset();
+	stateSnapshotPending = false;
+}
+
+/**
+*Checks wether the format of a plugin needs the message thread to be running while an instance is created.
+*@param xmlPluginDescription A string containing the XML Document which can be read as a PluginDescription.
+*@return Wether instances have to be created on the message thread.
+*/
+bool PluginHost::requiresMessageThreadForCreation(const char* xmlPluginDescription)
+{
+	PluginDescription description;
+	ScopedPointer<XmlElement> element = XmlDocument::parse(String(xmlPluginDescription));
+
+	if (element != nullptr && description.loadFromXml(*element))
+	{
+		for (int i = 0; i < formatManager->getNumFormats(); i++)
+		{
+			AudioPluginFormat* format = formatManager->getFormat(i);
+
+			if (format->getName() == description.pluginFormatName)
+				return format->requiresUnblockedMessageThreadDuringCreation(description);
+		}
+	}
+
+	return false;
+}
+
+/**
+*Sizes the channel pointer tables and scratch channels used while processing, so the audio thread never allocates.
+*@param maxBlockSize The largest number of samples the plugin will be asked to process at once.
+*/
+void PluginHost::allocateProcessingBuffers(int maxBlockSize)
+{
+	numPluginChannels = jmax(pluginInstance->getTotalNumInputChannels(), pluginInstance->getTotalNumOutputChannels());
+	maxSamplesPerBlock = jmax(1, maxBlockSize);
+
+	channelPointers.allocate((size_t) jmax(1, numPluginChannels), true);
+	planarPointers.allocate((size_t) jmax(1, numPluginChannels), true);
+	scratchChannels.setSize(jmax(1, numPluginChannels), maxSamplesPerBlock);
+	interleavedScratch.setSize(jmax(1, numPluginChannels), maxSamplesPerBlock);
+
+	channelPointersDouble.allocate((size_t) jmax(1, numPluginChannels), true);
+	scratchChannelsDouble.setSize(processingInDouble ? jmax(1, numPluginChannels) : 1, processingInDouble ? maxSamplesPerBlock : 1);
+	floatConversion.setSize(jmax(1, numPluginChannels), maxSamplesPerBlock);
+	doubleConversion.setSize(jmax(1, numPluginChannels), maxSamplesPerBlock);
+
+	crossfadeScratch.setSize(jmax(1, numPluginChannels), maxSamplesPerBlock);
+	crossfadeScratchDouble.setSize(processingInDouble ? jmax(1, numPluginChannels) : 1, processingInDouble ? maxSamplesPerBlock : 1);
+}
+
+/**
+*Sets the processing precision of plugin to double if it was requested and plugin supports it, and to single otherwise.
+*/
+void PluginHost::applyProcessingPrecision()
+{
+	processingInDouble = doublePrecisionRequested && pluginInstance->supportsDoublePrecisionProcessing();
+	pluginInstance->setProcessingPrecision(processingInDouble ? AudioProcessor::doublePrecision : AudioProcessor::singlePrecision);
+}
+
+/**
+*Processes planar audio in segments, or hands it to the re-blocking FIFO when re-blocking.
+*@param channels An array of pointers to the audio data of each channel.
+*@param numChannels The number of channel pointers in channels.
+*@param numSamples The number of samples in each channel.
+*@param blockStart The position of the first sample relative to the start of the block passed by the caller.
+*/
+void PluginHost::renderPlanar(float** channels, int numChannels, int numSamples, int blockStart)
+{
+	if (reblockSize > 0)
+		reblock(channels, numChannels, numSamples, blockStart);
+	else
+		renderSegments(channels, numChannels, numSamples, blockStart);
+}
+
+/**
+*Processes planar audio in segments which end at the next scheduled parameter change or at the prepared block size.
+*@param channels An array of pointers to the audio data of each channel.
+*@param numChannels The number of channel pointers in channels.
+*@param numSamples The number of samples in each channel.
+*@param blockStart The position of the first sample relative to the start of the block passed by the caller.
+*/
+template <typename SampleType>
+void PluginHost::renderSegments(SampleType** channels, int numChannels, int numSamples, int blockStart)
+{
+	int position = 0;
+
+	while (position < numSamples)
+	{
+		applyParameterEvents(blockStart + position);
+
+		int segmentEnd = jmin(numSamples, position + maxSamplesPerBlock);
+
+		if (nextPendingEvent < numPendingEvents)
+			segmentEnd = jmin(segmentEnd, pendingEvents[nextPendingEvent].sampleOffset - blockStart);
+
+		segmentMidiInput = &midiInput;
+		segmentMidiStart = blockStart + position;
+		segmentMidiOutputPosition = segmentMidiStart;
+
+		processSegment(channels, numChannels, position, segmentEnd - position);
+		position = segmentEnd;
+	}
+}
+
+/**
+*Runs the plugin on a segment of planar audio no longer than the prepared block size.
+*If plugin processes in double precision, the segment is converted on the way in and out.
+*@param channels An array of pointers to the audio data of each channel.
+*@param numChannels The number of channel pointers in channels.
+*@param startSample The first sample of the segment within each channel.
+*@param numSamples The number of samples in the segment.
+*/
+void PluginHost::processSegment(float** channels, int numChannels, int startSample, int numSamples)
+{
+	if (processingInDouble)
+	{
+		const int numChannelsToProcess = jmin(numChannels, numPluginChannels);
+		double** converted = doubleConversion.getArrayOfWritePointers();
+
+		for (int channel = 0; channel < numChannelsToProcess; channel++)
+			PrecisionConversion::toDouble(channels[channel] + startSample, converted[channel], numSamples);
+
+		processSegment(converted, numChannelsToProcess, 0, numSamples);
+
+		for (int channel = 0; channel < numChannelsToProcess; channel++)
+			PrecisionConversion::toFloat(converted[channel], channels[channel] + startSample, numSamples);
+
+		return;
+	}
+
+	for (int channel = 0; channel < numPluginChannels; channel++)
+	{
+		if (channel < numChannels)
+		{
+			channelPointers[channel] = channels[channel] + startSample;
+		}
+		else
+		{
+			channelPointers[channel] = scratchChannels.getWritePointer(channel);
+			FloatVectorOperations::clear(channelPointers[channel], numSamples);
+		}
+	}
+
+	audioData->setDataToReferTo(channelPointers, numPluginChannels, numSamples);
+	runPlugin(*audioData, crossfadeScratch, crossfadeView);
+}
+
+/**
+*Runs the plugin on a segment of planar double precision audio no longer than the prepared block size.
+*If plugin processes in single precision, the segment is converted on the way in and out.
+*@param channels An array of pointers to the audio data of each channel.
+*@param numChannels The number of channel pointers in channels.
+*@param startSample The first sample of the segment within each channel.
+*@param numSamples The number of samples in the segment.
+*/
+void PluginHost::processSegment(double** channels, int numChannels, int startSample, int numSamples)
+{
+	if (!processingInDouble)
+	{
+		const int numChannelsToProcess = jmin(numChannels, numPluginChannels);
+		float** converted = floatConversion.getArrayOfWritePointers();
+
+		for (int channel = 0; channel < numChannelsToProcess; channel++)
+			PrecisionConversion::toFloat(channels[channel] + startSample, converted[channel], numSamples);
+
+		processSegment(converted, numChannelsToProcess, 0, numSamples);
+
+		for (int channel = 0; channel < numChannelsToProcess; channel++)
+			PrecisionConversion::toDouble(converted[channel], channels[channel] + startSample, numSamples);
+
+		return;
+	}
+
+	for (int channel = 0; channel < numPluginChannels; channel++)
+	{
+		if (channel < numChannels)
+		{
+			channelPointersDouble[channel] = channels[channel] + startSample;
+		}
+		else
+		{
+			channelPointersDouble[channel] = scratchChannelsDouble.getWritePointer(channel);
+			FloatVectorOperations::clear(channelPointersDouble[channel], numSamples);
+		}
+	}
+
+	audioDataDouble.setDataToReferTo(channelPointersDouble, numPluginChannels, numSamples);
+	runPlugin(audioDataDouble, crossfadeScratchDouble, crossfadeViewDouble);
+}
+
+/**
+*Moves scheduled parameter changes from the queue to the pending list and sorts them by sample offset.
+*Called by the audio thread at the start of every block.
+*/
+void PluginHost::beginParameterEvents()
+{
+	numPendingEvents = parameterEvents.pop(pendingEvents, parameterEvents.getCapacity());
+	nextPendingEvent = 0;
+
+	// Insertion sort keeps changes to the same sample in the order they were scheduled, without allocating.
+	for (int i = 1; i < numPendingEvents; i++)
+	{
+		const ParameterEvent event = pendingEvents[i];
+		int j = i;
+
+		while (j > 0 && pendingEvents[j - 1].sampleOffset > event.sampleOffset)
+		{
+			pendingEvents[j] = pendingEvents[j - 1];
+			j--;
+		}
+
+		pendingEvents[j] = event;
+	}
+}
+
+/**
+*Applies pending parameter changes scheduled at or before a given sample of the current block.
+*@param upToSample The sample offset up to which changes should be applied.
+*/
+void PluginHost::applyParameterEvents(int upToSample)
+{
+	while (nextPendingEvent < numPendingEvents && pendingEvents[nextPendingEvent].sampleOffset <= upToSample)
+	{
+		const ParameterEvent& event = pendingEvents[nextPendingEvent++];
+		pluginInstance->setParameter(event.index, event.value);
+	}
+}
+
+/**
+*Passes planar audio through the re-blocking FIFO. Input is collected until a full plugin block is available,
+*which is then processed and played out while the next block is collected. Scheduled parameter changes land at the start of the next plugin block.
+*MIDI input travels through the FIFO with the audio, while MIDI output is returned at the point where the plugin block was processed.
+*@param channels An array of pointers to the audio data of each channel.
+*@param numChannels The number of channel pointers in channels.
+*@param numSamples The number of samples in each channel.
+*@param blockStart The position of the first sample relative to the start of the block passed by the caller.
+*/
+void PluginHost::reblock(float** channels, int numChannels, int numSamples, int blockStart)
+{
+	const int numChannelsToProcess = jmin(numChannels, numPluginChannels);
+	int position = 0;
+
+	while (position < numSamples)
+	{
+		const int chunkLength = jmin(numSamples - position, reblockSize - reblockPosition);
+		AudioBuffer<float>& input = reblockBuffers[reblockInput];
+		AudioBuffer<float>& output = reblockBuffers[1 - reblockInput];
+
+		// Read the input before writing the output, as the caller's buffers are processed in place.
+		for (int channel = 0; channel < numChannelsToProcess; channel++)
+		{
+			input.copyFrom(channel, reblockPosition, channels[channel] + position, chunkLength);
+			FloatVectorOperations::copy(channels[channel] + position, output.getReadPointer(channel, reblockPosition), chunkLength);
+		}
+
+		for (int channel = numChannelsToProcess; channel < numPluginChannels; channel++)
+			input.clear(channel, reblockPosition, chunkLength);
+
+		const int chunkStart = blockStart + position;
+		reblockMidi.addEvents(midiInput, chunkStart, chunkLength, reblockPosition - chunkStart);
+
+		reblockPosition += chunkLength;
+		position += chunkLength;
+
+		if (reblockPosition == reblockSize)
+		{
+			segmentMidiInput = &reblockMidi;
+			segmentMidiStart = 0;
+			segmentMidiOutputPosition = blockStart + position - 1;
+
+			applyParameterEvents(std::numeric_limits<int>::max());
+			processSegment(input.getArrayOfWritePointers(), numPluginChannels, 0, reblockSize);
+			reblockMidi.clear();
+			reblockInput = 1 - reblockInput;
+			reblockPosition = 0;
+		}
+	}
+}
+
+/**
+*Sizes and silences the re-blocking FIFO.
+*/
+void PluginHost::resetReblocking()
+{
+	for (auto& buffer : reblockBuffers)
+	{
+		buffer.setSize(jmax(1, numPluginChannels), jmax(1, reblockSize));
+		buffer.clear();
+	}
+
+	reblockMidi.clear();
+	reblockInput = 0;
+	reblockPosition = 0;
+}
+
+/**
+*Runs the plugin on a buffer in place, feeding it the MIDI events of the segment. While switching presets, the instance switched away from runs on a copy
+*of the input as well, and the outputs are crossfaded.
+*@param buffer The buffer to process, referring to the segment.
+*@param fadeScratch Preallocated channels for the output of the instance being faded out.
+*@param fadeView A buffer for referring to fadeScratch at the length of the segment.
+*/
+template <typename SampleType>
+void PluginHost::runPlugin(AudioBuffer<SampleType>& buffer, AudioBuffer<SampleType>& fadeScratch, AudioBuffer<SampleType>& fadeView)
+{
+	const int numChannels = buffer.getNumChannels();
+	const int numSamples = buffer.getNumSamples();
+
+	if (fadingInstance != nullptr)
+	{
+		for (int channel = 0; channel < numChannels; channel++)
+			fadeScratch.copyFrom(channel, 0, buffer, channel, 0, numSamples);
+
+		// The instance being faded out only plays out what it has, new notes go to the new one.
+		midiData->clear();
+		fadeView.setDataToReferTo(fadeScratch.getArrayOfWritePointers(), numChannels, numSamples);
+		fadingInstance->processBlock(fadeView, *midiData);
+	}
+
+	midiData->clear();
+
+	if (segmentMidiInput != nullptr)
+		midiData->addEvents(*segmentMidiInput, segmentMidiStart, numSamples, -segmentMidiStart);
+
+	pluginInstance->processBlock(buffer, *midiData);
+
+	// The plugin leaves its MIDI output in the buffer it was given.
+	if (collectingMidiOutput)
+		midiOutput.addEvents(*midiData, 0, -1, segmentMidiOutputPosition);
+
+	if (fadingInstance == nullptr)
+		return;
+
+	const int remaining = jmax(0, crossfadeRemaining - numSamples);
+	const SampleType startGain = (SampleType) (crossfadeLength - crossfadeRemaining) / (SampleType) crossfadeLength;
+	const SampleType endGain = (SampleType) (crossfadeLength - remaining) / (SampleType) crossfadeLength;
+
+	for (int channel = 0; channel < numChannels; channel++)
+	{
+		buffer.applyGainRamp(channel, 0, numSamples, startGain, endGain);
+		buffer.addFromWithRamp(channel, 0, fadeScratch.getReadPointer(channel), numSamples, (SampleType) 1 - startGain, (SampleType) 1 - endGain);
+	}
+
+	crossfadeRemaining = remaining;
+
+	if (crossfadeRemaining == 0)
+		finishPresetSwap();
+}
+
+/**
+*Creates the shadow instance used for switching presets, if it doesn't exist yet, and prepares it like the plugin.
+*Must not be called while a switch is in progress.
+*@return Wether the shadow instance is ready.
+*/
+bool PluginHost::prepareShadowInstance()
+{
+	if (shadowInstance != nullptr)
+		return true;
+
+	String error;
+	shadowInstance = formatManager->createPluginInstance(*pluginDescription, currentSampleRate, maxSamplesPerBlock, error);
+
+	if (shadowInstance == nullptr)
+		return false;
+
+	shadowInstance->setProcessingPrecision(processingInDouble ? AudioProcessor::doublePrecision : AudioProcessor::singlePrecision);
+	shadowInstance->setNonRealtime(pluginInstance->isNonRealtime());
+	shadowInstance->setRateAndBufferSizeDetails(currentSampleRate, maxSamplesPerBlock);
+	shadowInstance->prepareToPlay(currentSampleRate, maxSamplesPerBlock);
+	return true;
+}
+
+/**
+*Swaps a shadow instance holding a new preset in for the plugin, if a switch was started. Only moves pointers, so it is
+*safe on the audio thread. Called at the start of every block.
+*Other threads only use the plugin while holding the instance lock for reading, so the swap only happens if the lock can be
+*taken for writing without waiting. Otherwise it is tried again on the next block.
+*/
+void PluginHost::beginPresetSwap()
+{
+	if (presetSwapState.load(std::memory_order_acquire) != swapPending || !instanceLock.tryEnterWrite())
+		return;
+
+	fadingInstance = pluginInstance.release();
+	pluginInstance = shadowInstance.release();
+	instanceLock.exitWrite();
+
+	crossfadeLength = pendingCrossfadeSamples;
+	crossfadeRemaining = pendingCrossfadeSamples;
+	presetSwapState.store(swapFading, std::memory_order_relaxed);
+
+	if (crossfadeRemaining == 0)
+		finishPresetSwap();
+}
+
+/**
+*Keeps the instance switched away from as the shadow for the next switch, and lets other threads switch again.
+*No instance is deleted here: the shadow was moved into the plugin when the switch began, so nothing is freed on the audio thread.
+*Unused instances are only deleted by dropShadowInstance, on the thread preparing or releasing the plugin.
+*/
+void PluginHost::finishPresetSwap()
+{
+	jassert(shadowInstance == nullptr);
+	shadowInstance = fadingInstance.release();
+	crossfadeRemaining = 0;
+	presetSwapState.store(swapIdle, std::memory_order_release);
+}
+
+/**
+*Deletes the instances kept for switching presets. A switch not yet picked up by the audio thread is cancelled,
+*and one being crossfaded is completed at once. Must not be called while processing.
+*/
+void PluginHost::dropShadowInstance()
+{
+	fadingInstance = nullptr;
+	shadowInstance = nullptr;
+	crossfadeRemaining = 0;
+	presetSwapState = swapIdle;
+}
@@ -11,6 +11,58 @@
 
 #pragma once
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "ParameterNameIndex.h"
+#include "ParameterEventQueue.h"
+#include <atomic>
+
+class PluginHost;
+
+/**
+* Called from a loader thread when an asynchronous instantiation has finished.
+*/
+typedef void (*InstantiationCallback)(PluginHost* host, bool succeeded);
+
+/**
+* The threads shared by every host for instantiating plugins in the background.
+*/
+class PluginLoaderPool : public ThreadPool
+{
+public:
+	PluginLoaderPool() : ThreadPool(jmax(2, SystemStats::getNumCpus())) {}
+};
+
+/**
+* Flat description of a plugin parameter, laid out for copying across the C API.
+* Name and label are null-terminated UTF-8 strings at the given offsets into a separate string blob.
+*/
+struct ParameterInfo
+{
+	enum Flags
+	{
+		automatable = 1,
+		metaParameter = 2
+	};
+
+	int32 index;
+	int32 nameOffset;
+	int32 labelOffset;
+	float defaultValue;
+	float value;
+	int32 numSteps;
+	int32 flags;
+};
+
+/**
+* A MIDI event laid out for passing across the C API in packed arrays.
+* Messages of up to 3 bytes are stored in bytes, longer SysEx messages in a separate blob at sysExOffset.
+*/
+struct PackedMidiEvent
+{
+	int32 sampleOffset;
+	int32 size;
+	int32 sysExOffset;
+	uint8 bytes[4];
+};
 
 /**
 * A tiny audio plugin host which can instantiate plugins, process audio and set parameters.
@@ -18,38 +70,177 @@
 class PluginHost
 {
 public:
+	enum InstantiationState
+	{
+		notInstantiated = 0,
+		instantiating = 1,
+		instantiated = 2,
+		instantiationFailed = 3
+	};
+
 	PluginHost();
 	~PluginHost();
 
-	bool instantiatePlugin(char* xmlPluginDescription, double sampleRate, int bufferSize);
+	void setHeadless(bool shouldBeHeadless);
+	bool instantiatePlugin(const char* xmlPluginDescription, double sampleRate, int bufferSize);
+	bool instantiatePlugin(const PluginDescription& description, double sampleRate, int bufferSize);
+	bool instantiatePluginAsync(const char* xmlPluginDescription, double sampleRate, int bufferSize, InstantiationCallback callback);
+	int getInstantiationState();
+	bool createEditor();
+	void closeEditor();
 	void prepareToPlay(double sampleRate, int expectedSamplesPerBlock);
 	bool suspendPlugin(bool shouldBeSuspended);
+	bool setNonRealtime(bool isNonRealtime);
+	bool resetPlugin();
+	bool resetModes();
 	bool releasePlugin();
+	int getStateSize(bool currentProgramOnly);
+	int getState(void* out, int capacity, bool currentProgramOnly);
+	bool setState(const void* data, int size, bool currentProgramOnly);
+
+	int addPresetToBank(const void* data, int size, bool currentProgramOnly);
+	void clearPresetBank();
+	int getNumBankPresets();
+	bool switchToPreset(int index, int crossfadeSamples);
+	bool isSwitchingPreset();
 
 	void processBlock(float* buffer, int bufferLength, int numChannels);
+	void processBlockPlanar(float** channels, int numChannels, int numSamples);
+	void processBlockInterleaved(float* buffer, int numFrames, int numChannels);
+	void processBlockDouble(double** channels, int numChannels, int numSamples);
+	int processBlockWithMidi(float** channels, int numChannels, int numSamples, const PackedMidiEvent* events, int numEvents,
+							 const uint8* sysExData, int sysExSize, PackedMidiEvent* outputEvents, int outputCapacity,
+							 uint8* outputSysExData, int outputSysExCapacity);
+	bool setDoublePrecision(bool shouldUseDoublePrecision);
+	bool setReblocking(bool shouldReblock, int pluginBlockSize);
+	int getHostLatencySamples();
 
 	int getNumInputs();
 	int getNumOutputs();
+	int getLatencySamples();
 
 	int getNumParameters();
 	int getNumNamedParameters();
 	String getParameterName(int index);
+	int getParameterIndex(char* name);
 	float getValueByName(char* name);
 	bool setValueByName(char* name, float value);
 	float getValueByIndex(int index);
 	bool setValueByIndex(int index, float value);
+	int getValuesByIndex(const int* indices, float* values, int count);
+	int setValuesByIndex(const int* indices, const float* values, int count);
+	int getAllValues(float* values, int capacity);
+	bool scheduleValueByIndex(int index, float value, int sampleOffset);
+	void clearScheduledValues();
+	int getParameterInfoTable(ParameterInfo* infos, int capacity, char* strings, int stringCapacity, int* requiredStringSize);
 
 private:
+	class InstantiationJob;
+
+	enum PresetSwapState
+	{
+		swapIdle,
+		swapPending,
+		swapFading
+	};
+
+	struct BankedPreset
+	{
+		MemoryBlock state;
+		bool currentProgramOnly;
+	};
+
 	AudioProcessorParameter* getParameterByName(char* name);
+	static bool parseDescription(const char* xmlPluginDescription, PluginDescription& description);
+	bool createInstance(const PluginDescription& description, double sampleRate, int bufferSize, bool withEditor);
+	bool requiresMessageThreadForCreation(const char* xmlPluginDescription);
+	void stopInstantiationJob();
+	static void* deleteEditorOnMessageThread(void* host);
+	void captureState(bool currentProgramOnly);
+	void invalidateStateSnapshot();
+	void allocateProcessingBuffers(int maxBlockSize);
+	void renderPlanar(float** channels, int numChannels, int numSamples, int blockStart);
+	template <typename SampleType>
+	void renderSegments(SampleType** channels, int numChannels, int numSamples, int blockStart);
+	void processSegment(float** channels, int numChannels, int startSample, int numSamples);
+	void processSegment(double** channels, int numChannels, int startSample, int numSamples);
+	void applyProcessingPrecision();
+	void reblock(float** channels, int numChannels, int numSamples, int blockStart);
+	void resetReblocking();
+	void beginParameterEvents();
+	void applyParameterEvents(int upToSample);
+	template <typename SampleType>
+	void runPlugin(AudioBuffer<SampleType>& buffer, AudioBuffer<SampleType>& fadeScratch, AudioBuffer<SampleType>& fadeView);
+	bool prepareShadowInstance();
+	void beginPresetSwap();
+	void finishPresetSwap();
+	void dropShadowInstance();
 
 	ScopedPointer<AudioPluginFormatManager> formatManager;
 	ScopedPointer<AudioPluginInstance> pluginInstance;
+	ReadWriteLock instanceLock;
 	ScopedPointer<PluginDescription> pluginDescription;
 	ScopedPointer<AudioProcessorEditor> pluginEditor;
-	bool pluginInstantiated = false;
+	std::atomic<bool> pluginInstantiated { false };
+	bool headless = false;
+
+	SharedResourcePointer<PluginLoaderPool> loaderPool;
+	ScopedPointer<ThreadPoolJob> instantiationJob;
+	std::atomic<int> instantiationState { notInstantiated };
+
+	ParameterNameIndex parameterNames;
+	CriticalSection stateSnapshotLock;
+	MemoryBlock stateSnapshot;
+	bool stateSnapshotPending = false;
+	bool stateSnapshotIsProgram = false;
 
 	ScopedPointer<AudioBuffer<float>> audioData;
 	ScopedPointer<MidiBuffer> midiData;
+	MidiBuffer midiInput;
+	MidiBuffer midiOutput;
+	MidiBuffer reblockMidi;
+	const MidiBuffer* segmentMidiInput = nullptr;
+	int segmentMidiStart = 0;
+	int segmentMidiOutputPosition = 0;
+	bool collectingMidiOutput = false;
+
+	HeapBlock<float*> channelPointers;
+	HeapBlock<float*> planarPointers;
+	AudioBuffer<float> scratchChannels;
+	AudioBuffer<float> interleavedScratch;
+
+	bool doublePrecisionRequested = false;
+	bool processingInDouble = false;
+	AudioBuffer<double> audioDataDouble;
+	HeapBlock<double*> channelPointersDouble;
+	AudioBuffer<double> scratchChannelsDouble;
+	AudioBuffer<float> floatConversion;
+	AudioBuffer<double> doubleConversion;
+	int numPluginChannels = 0;
+	int maxSamplesPerBlock = 0;
+	double currentSampleRate = 44100.0;
+
+	AudioBuffer<float> reblockBuffers[2];
+	int reblockInput = 0;
+	int reblockPosition = 0;
+	int reblockSize = 0;
+
+	ParameterEventQueue parameterEvents { 1024 };
+	HeapBlock<ParameterEvent> pendingEvents;
+	int numPendingEvents = 0;
+	int nextPendingEvent = 0;
+
+	OwnedArray<BankedPreset> presetBank;
+	ScopedPointer<AudioPluginInstance> shadowInstance;
+	ScopedPointer<AudioPluginInstance> fadingInstance;
+	std::atomic<int> presetSwapState { swapIdle };
+	int pendingCrossfadeSamples = 0;
+	int crossfadeLength = 0;
+	int crossfadeRemaining = 0;
+	AudioBuffer<float> crossfadeScratch;
+	AudioBuffer<float> crossfadeView;
+	AudioBuffer<double> crossfadeScratchDouble;
+	AudioBuffer<double> crossfadeViewDouble;
 
 	int maxNameLength = 50;
 };
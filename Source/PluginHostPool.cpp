@@ -0,0 +1,252 @@
+/*
+	==============================================================================
+
+	PluginHostPool
+	by Daniel Rothmann
+
+	A pool of identical plugin hosts processing many independent streams across worker threads
+
+	==============================================================================
+*/
+
+#include "PluginHostPool.h"
+
+namespace
+{
+	const int blocksBetweenRebalancing = 64;
+	const double costSmoothing = 0.1;
+}
+
+/**
+*Constructs an empty pool and starts its worker threads.
+*@param numShards The number of threads streams are spread across, including the thread calling processBlock.
+*@param pinThreadsToCores Wether each worker thread should be restricted to its own CPU core.
+*/
+PluginHostPool::PluginHostPool(int numShards, bool pinThreadsToCores)
+{
+	for (int shard = 0; shard < jmax(1, numShards); shard++)
+		shards.add(new Shard());
+
+	// The thread calling processBlock takes care of shard 0, and each worker of the shard matching its participant index.
+	workers = new BlockWorkerGroup(*this, "PluginHostPool worker", shards.size() - 1, pinThreadsToCores);
+}
+
+PluginHostPool::~PluginHostPool()
+{
+	// Stop the workers before the shards they process are destroyed.
+	workers = nullptr;
+}
+
+/**
+*Instantiates copies of one plugin, one for each stream, and prepares them for playback. Replaces any plugins already in the pool.
+*@param xmlPluginDescription A string containing the XML Document which can be read as a PluginDescription.
+*@param numInstances The number of copies to instantiate.
+*@param sampleRate The sample rate to initialize plugins with.
+*@param bufferSize The buffer size to initialize plugins with.
+*@return A boolean representing wether every copy was instantiated. If any failed, the plugins already in the pool are kept.
+*/
+bool PluginHostPool::instantiatePlugins(char* xmlPluginDescription, int numInstances, double sampleRate, int bufferSize)
+{
+	OwnedArray<PluginHost> newHosts;
+
+	for (int index = 0; index < numInstances; index++)
+	{
+		auto* host = newHosts.add(new PluginHost());
+		host->setHeadless(true);
+
+		if (!host->instantiatePlugin(xmlPluginDescription, sampleRate, bufferSize))
+			return false;
+
+		host->prepareToPlay(sampleRate, bufferSize);
+	}
+
+	const ScopedLock control(controlLock);
+	const ScopedLock lock(poolLock);
+
+	hosts.swapWith(newHosts);
+	instanceCosts.clearQuick();
+	instanceCosts.insertMultiple(0, 0.0, hosts.size());
+	instancesByCost.clearQuick();
+
+	for (int index = 0; index < hosts.size(); index++)
+		instancesByCost.add(index);
+
+	for (auto* shard : shards)
+		shard->instances.ensureStorageAllocated(hosts.size());
+
+	rebalanceShards();
+	return true;
+}
+
+/**
+*Releases every plugin in the pool.
+*/
+void PluginHostPool::releasePlugins()
+{
+	OwnedArray<PluginHost> oldHosts;
+
+	{
+		const ScopedLock control(controlLock);
+		const ScopedLock lock(poolLock);
+
+		hosts.swapWith(oldHosts);
+		instanceCosts.clearQuick();
+		instancesByCost.clearQuick();
+
+		for (auto* shard : shards)
+			shard->instances.clearQuick();
+	}
+
+	for (auto* host : oldHosts)
+		host->releasePlugin();
+}
+
+/**
+*Prepares every plugin in the pool for playback.
+*@param sampleRate The sample rate to initialize plugins with.
+*@param expectedSamplesPerBlock The maximum buffer size to expect.
+*/
+void PluginHostPool::prepareToPlay(double sampleRate, int expectedSamplesPerBlock)
+{
+	const ScopedLock control(controlLock);
+	const ScopedLock lock(poolLock);
+
+	for (auto* host : hosts)
+		host->prepareToPlay(sampleRate, expectedSamplesPerBlock);
+}
+
+/**
+*Processes one block for every stream in the pool, spreading the shards across worker threads and returning once all are done.
+*If the pool is being changed on another thread, the streams are passed through unprocessed.
+*@param streamChannels An array of channel pointers, numChannels for each stream in instance order.
+*@param numChannels The number of channels in each stream.
+*@param numSamples The number of samples in each channel.
+*/
+void PluginHostPool::processBlock(float** streamChannels, int numChannels, int numSamples)
+{
+	const ScopedTryLock lock(poolLock);
+
+	if (!lock.isLocked() || streamChannels == nullptr || hosts.isEmpty())
+		return;
+
+	currentStreams = streamChannels;
+	currentNumChannels = numChannels;
+	currentNumSamples = numSamples;
+
+	workers->runBlock();
+
+	if (++blocksSinceRebalance >= blocksBetweenRebalancing)
+		rebalanceShards();
+}
+
+/**
+*Gets the number of plugin copies in the pool. Only takes the control lock, so polling it never makes processing pass a block through.
+*@return The number of instances.
+*/
+int PluginHostPool::getNumInstances()
+{
+	const ScopedLock control(controlLock);
+	return hosts.size();
+}
+
+/**
+*Gets the host of one copy in the pool, for setting parameters.
+*@param index The index of the instance, matching the order of streams.
+*@return The host of the instance. If there is no instance at index, nullptr is returned.
+*/
+PluginHost* PluginHostPool::getInstance(int index)
+{
+	const ScopedLock control(controlLock);
+	return hosts[index];
+}
+
+/**
+*Gets the number of shards streams are spread across.
+*@return The number of shards.
+*/
+int PluginHostPool::getNumShards()
+{
+	return shards.size();
+}
+
+/**
+*Gets how long a shard spent processing its streams during the last block.
+*@param shard The index of the shard.
+*@return The processing time in milliseconds. If there is no shard at that index, 0 is returned.
+*/
+double PluginHostPool::getShardProcessingTime(int shard)
+{
+	// Shards never change after construction, so polling timings doesn't need the lock that would hold up processing.
+	if (isPositiveAndBelow(shard, shards.size()))
+		return shards[shard]->lastProcessingTime.load(std::memory_order_relaxed);
+
+	return 0.0;
+}
+
+/**
+*Processes the streams of every instance in a shard and measures the cost of each.
+*@param shard The index of the shard to process, which is the participant index of the thread processing it.
+*/
+void PluginHostPool::runParticipant(int shard)
+{
+	Shard& current = *shards.getUnchecked(shard);
+	const double shardStart = Time::getMillisecondCounterHiRes();
+
+	for (int instance : current.instances)
+	{
+		const double instanceStart = Time::getMillisecondCounterHiRes();
+		hosts.getUnchecked(instance)->processBlockPlanar(currentStreams + instance * currentNumChannels, currentNumChannels, currentNumSamples);
+
+		// Each instance belongs to exactly one shard, so only this thread writes its cost.
+		double& cost = instanceCosts.getReference(instance);
+		cost += (Time::getMillisecondCounterHiRes() - instanceStart - cost) * costSmoothing;
+	}
+
+	current.lastProcessingTime.store(Time::getMillisecondCounterHiRes() - shardStart, std::memory_order_relaxed);
+}
+
+/**
+*Reassigns instances to shards so the measured cost is spread evenly, placing the most expensive instances first.
+*Only called while no shard is being processed, and doesn't allocate.
+*/
+void PluginHostPool::rebalanceShards()
+{
+	blocksSinceRebalance = 0;
+
+	for (auto* shard : shards)
+	{
+		shard->instances.clearQuick();
+		shard->load = 0.0;
+	}
+
+	struct CostComparator
+	{
+		CostComparator(const Array<double>& c) : costs(c) {}
+
+		int compareElements(int first, int second) const
+		{
+			if (costs[first] > costs[second]) return -1;
+			if (costs[first] < costs[second]) return 1;
+			return first - second;
+		}
+
+		const Array<double>& costs;
+	};
+
+	CostComparator comparator(instanceCosts);
+	instancesByCost.sort(comparator);
+
+	for (int instance : instancesByCost)
+	{
+		Shard* leastLoaded = shards.getFirst();
+
+		for (auto* shard : shards)
+			if (shard->load < leastLoaded->load)
+				leastLoaded = shard;
+
+		leastLoaded->instances.add(instance);
+
+		// Before anything is measured, every instance counts as equally expensive.
+		leastLoaded->load += jmax(instanceCosts[instance], 1.0e-6);
+	}
+}
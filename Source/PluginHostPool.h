@@ -0,0 +1,65 @@
+/*
+	==============================================================================
+
+	PluginHostPool
+	by Daniel Rothmann
+
+	A pool of identical plugin hosts processing many independent streams across worker threads
+
+	==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PluginHost.h"
+#include "BlockWorkerGroup.h"
+#include <atomic>
+
+/**
+* A pool of identical plugin hosts, one per audio stream, split into shards which are each processed by one thread.
+* Shards are rebalanced from the measured processing cost of each instance, so expensive instances are spread out.
+*/
+class PluginHostPool : private BlockWorkerGroup::Job
+{
+public:
+	PluginHostPool(int numShards, bool pinThreadsToCores);
+	~PluginHostPool();
+
+	bool instantiatePlugins(char* xmlPluginDescription, int numInstances, double sampleRate, int bufferSize);
+	void releasePlugins();
+	void prepareToPlay(double sampleRate, int expectedSamplesPerBlock);
+
+	void processBlock(float** streamChannels, int numChannels, int numSamples);
+
+	int getNumInstances();
+	PluginHost* getInstance(int index);
+	int getNumShards();
+	double getShardProcessingTime(int shard);
+
+private:
+	struct Shard
+	{
+		Array<int> instances;
+		double load = 0.0;
+		std::atomic<double> lastProcessingTime { 0.0 };
+	};
+
+	void runParticipant(int shard) override;
+	void rebalanceShards();
+
+	OwnedArray<PluginHost> hosts;
+	OwnedArray<Shard> shards;
+	Array<double> instanceCosts;
+	Array<int> instancesByCost;
+
+	// Control threads reading or changing the pool take controlLock. Only changes also take poolLock, which processBlock tries to take.
+	CriticalSection controlLock;
+	CriticalSection poolLock;
+
+	float** currentStreams = nullptr;
+	int currentNumChannels = 0;
+	int currentNumSamples = 0;
+	int blocksSinceRebalance = 0;
+
+	ScopedPointer<BlockWorkerGroup> workers;
+};
@@ -0,0 +1,462 @@
+/*
+	==============================================================================
+
+	PluginIndex
+	by Daniel Rothmann
+
+	Secondary indices over the known plugins, for fast lookups and filtered queries
+
+	==============================================================================
+*/
+
+#include "PluginIndex.h"
+
+/**
+*Constructs an empty index.
+*/
+PluginIndex::PluginIndex()
+{
+}
+
+PluginIndex::~PluginIndex()
+{
+}
+
+/**
+*Adds a plugin to the index, or indexes it again under its existing handle if its description changed.
+*@param description The description of the plugin.
+*@return The handle of the plugin.
+*/
+int PluginIndex::add(const PluginDescription& description)
+{
+	const String identifierKey = createIdentifierKey(description.createIdentifierString());
+
+	if (slotsByIdentifier.contains(identifierKey))
+	{
+		const int slot = slotsByIdentifier[identifierKey];
+		Entry& entry = *entries[slot];
+
+		if (!describesSamePlugin(entry.description, description))
+		{
+			removeFromIndices(slot);
+			setFields(entry, description);
+			addToIndices(slot);
+		}
+
+		return makeHandle(slot);
+	}
+
+	int slot;
+
+	if (freeSlots.isEmpty())
+	{
+		slot = entries.size();
+		jassert(slot < (1 << slotBits));
+		entries.add(new Entry());
+	}
+	else
+	{
+		slot = freeSlots.getLast();
+		freeSlots.removeLast();
+	}
+
+	Entry& entry = *entries[slot];
+	entry.identifierKey = identifierKey;
+	entry.inUse = true;
+	setFields(entry, description);
+
+	slotsByIdentifier.set(identifierKey, slot);
+	addToIndices(slot);
+	return makeHandle(slot);
+}
+
+/**
+*Removes a plugin from the index and invalidates its handle.
+*@param identifier The identifier string of the plugin.
+*/
+void PluginIndex::remove(const String& identifier)
+{
+	const String identifierKey = createIdentifierKey(identifier);
+
+	if (slotsByIdentifier.contains(identifierKey))
+		removeSlot(slotsByIdentifier[identifierKey]);
+}
+
+/**
+*Removes all plugins of a file from the index and invalidates their handles.
+*@param fileOrIdentifier The path of the plugin file.
+*/
+void PluginIndex::removeFile(const String& fileOrIdentifier)
+{
+	if (const Array<int>* found = slotsByFile.find(fileOrIdentifier))
+	{
+		const Array<int> slots = *found;
+
+		for (int slot : slots)
+			removeSlot(slot);
+	}
+}
+
+/**
+*Removes every plugin from the index and invalidates all handles, without shrinking the storage for the next plugins.
+*/
+void PluginIndex::clear()
+{
+	freeSlots.clearQuick();
+
+	for (int slot = entries.size(); --slot >= 0;)
+	{
+		Entry& entry = *entries[slot];
+
+		if (entry.inUse)
+		{
+			entry.inUse = false;
+			entry.generation++;
+			entry.description = PluginDescription();
+		}
+
+		freeSlots.add(slot);
+	}
+
+	slotsByIdentifier.clear();
+	slotsByFile.clear();
+	slotsByManufacturer.clear();
+	slotsByCategory.clear();
+	slotsByFormat.clear();
+	slotsByName.clearQuick();
+}
+
+/**
+*Gets the description of a plugin by its handle.
+*@param handle The handle of the plugin.
+*@return The description, or nullptr if the handle is stale or invalid.
+*/
+const PluginDescription* PluginIndex::getDescription(int handle) const
+{
+	const int slot = findSlot(handle);
+	return slot >= 0 ? &entries[slot]->description : nullptr;
+}
+
+/**
+*Finds a plugin by its identifier string.
+*@param identifier The identifier string of the plugin.
+*@return The handle of the plugin, or -1 if it isn't in the index.
+*/
+int PluginIndex::getHandleForIdentifier(const String& identifier) const
+{
+	const String identifierKey = createIdentifierKey(identifier);
+	return slotsByIdentifier.contains(identifierKey) ? makeHandle(slotsByIdentifier[identifierKey]) : -1;
+}
+
+/**
+*Gets the part of an identifier string which PluginDescription::matchesIdentifierString compares: the file hash and uid
+*it ends with, lowercase. The format and name in front of them are left out, as they may contain dashes themselves.
+*@param identifier An identifier string created by PluginDescription::createIdentifierString.
+*@return The key plugins are looked up by.
+*/
+String PluginIndex::createIdentifierKey(const String& identifier)
+{
+	const int uidStart = identifier.lastIndexOfChar('-');
+	const int hashStart = uidStart > 0 ? identifier.substring(0, uidStart).lastIndexOfChar('-') : -1;
+	return identifier.substring(jmax(0, hashStart)).toLowerCase();
+}
+
+/**
+*Finds the first plugin of a file.
+*@param fileOrIdentifier The path of the plugin file.
+*@return The handle of the plugin, or -1 if no plugin of the file is in the index.
+*/
+int PluginIndex::getHandleForFile(const String& fileOrIdentifier) const
+{
+	const Array<int>* slots = slotsByFile.find(fileOrIdentifier);
+	return slots != nullptr && !slots->isEmpty() ? makeHandle(slots->getFirst()) : -1;
+}
+
+/**
+*Finds the plugins matching a filter, sorted by name. Only the smallest of the indices the filter selects is walked:
+*the name range for a prefix, or the plugins of one manufacturer, category or format.
+*@param filter The filter.
+*@param results An array to fill with the matching plugins. May be nullptr to only count them.
+*@param capacity The number of results the array can hold.
+*@return The number of matching plugins, which may be larger than the capacity.
+*/
+int PluginIndex::query(const PluginQuery& filter, PluginQueryResult* results, int capacity) const
+{
+	const String namePrefix = String::fromUTF8(filter.namePrefix != nullptr ? filter.namePrefix : "").toLowerCase();
+	const String manufacturer = String::fromUTF8(filter.manufacturer != nullptr ? filter.manufacturer : "").toLowerCase();
+	const String category = String::fromUTF8(filter.category != nullptr ? filter.category : "").toLowerCase();
+	const String formatName = String::fromUTF8(filter.formatName != nullptr ? filter.formatName : "").toLowerCase();
+
+	int nameStart = 0;
+	int nameEnd = slotsByName.size();
+
+	if (namePrefix.isNotEmpty())
+	{
+		nameStart = findNamePosition(namePrefix, -1);
+		nameEnd = nameStart;
+
+		while (nameEnd < slotsByName.size() && entries[slotsByName[nameEnd]]->name.startsWith(namePrefix))
+			nameEnd++;
+	}
+
+	const Array<int>* smallestBucket = nullptr;
+	const Buckets* buckets[] = { &slotsByManufacturer, &slotsByCategory, &slotsByFormat };
+	const String* keys[] = { &manufacturer, &category, &formatName };
+
+	for (int i = 0; i < 3; i++)
+	{
+		if (keys[i]->isEmpty())
+			continue;
+
+		const Array<int>* bucket = buckets[i]->find(*keys[i]);
+
+		if (bucket == nullptr)
+			return 0;
+
+		if (smallestBucket == nullptr || bucket->size() < smallestBucket->size())
+			smallestBucket = bucket;
+	}
+
+	Array<int> matchingSlots;
+
+	if (smallestBucket != nullptr && smallestBucket->size() < nameEnd - nameStart)
+	{
+		for (int slot : *smallestBucket)
+		{
+			if (matches(*entries[slot], filter, namePrefix, manufacturer, category, formatName))
+				matchingSlots.add(slot);
+		}
+
+		struct NameOrder
+		{
+			const PluginIndex& index;
+
+			int compareElements(int first, int second) const
+			{
+				const int order = index.entries[first]->name.compare(index.entries[second]->name);
+				return order != 0 ? order : first - second;
+			}
+		};
+
+		NameOrder order = { *this };
+		matchingSlots.sort(order);
+	}
+	else
+	{
+		for (int i = nameStart; i < nameEnd; i++)
+		{
+			if (matches(*entries[slotsByName[i]], filter, namePrefix, manufacturer, category, formatName))
+				matchingSlots.add(slotsByName[i]);
+		}
+	}
+
+	for (int i = 0; i < jmin(capacity, matchingSlots.size()) && results != nullptr; i++)
+	{
+		const PluginDescription& description = entries[matchingSlots[i]]->description;
+		PluginQueryResult& result = results[i];
+
+		result.handle = makeHandle(matchingSlots[i]);
+		result.uid = description.uid;
+		result.numInputChannels = description.numInputChannels;
+		result.numOutputChannels = description.numOutputChannels;
+		result.flags = (description.isInstrument ? PluginQueryResult::instrument : 0) | (description.hasSharedContainer ? PluginQueryResult::sharedContainer : 0);
+	}
+
+	return matchingSlots.size();
+}
+
+/**
+*Combines a slot with its current generation into a handle. The generation wraps around, so only a handle which
+*went stale thousands of reuses of its slot ago could be mistaken for a current one.
+*/
+int PluginIndex::makeHandle(int slot) const
+{
+	const int generationMask = (1 << (31 - slotBits)) - 1;
+	return ((entries[slot]->generation & generationMask) << slotBits) | slot;
+}
+
+/**
+*Finds the slot a handle refers to.
+*@return The slot, or -1 if the handle is stale or invalid.
+*/
+int PluginIndex::findSlot(int handle) const
+{
+	if (handle < 0)
+		return -1;
+
+	const int slot = handle & ((1 << slotBits) - 1);
+
+	if (!isPositiveAndBelow(slot, entries.size()) || !entries[slot]->inUse || makeHandle(slot) != handle)
+		return -1;
+
+	return slot;
+}
+
+/**
+*Removes a plugin from every index and frees its slot for the next plugin, under a new generation.
+*/
+void PluginIndex::removeSlot(int slot)
+{
+	Entry& entry = *entries[slot];
+	removeFromIndices(slot);
+	slotsByIdentifier.remove(entry.identifierKey);
+
+	entry.inUse = false;
+	entry.generation++;
+	entry.description = PluginDescription();
+	freeSlots.add(slot);
+}
+
+/**
+*Copies a description into an entry, along with the lowercase keys it is indexed by.
+*/
+void PluginIndex::setFields(Entry& entry, const PluginDescription& description)
+{
+	entry.description = description;
+	entry.name = description.name.toLowerCase();
+	entry.manufacturer = description.manufacturerName.toLowerCase();
+	entry.category = description.category.toLowerCase();
+	entry.formatName = description.pluginFormatName.toLowerCase();
+}
+
+/**
+*Adds a plugin to the file, manufacturer, category, format and name indices.
+*/
+void PluginIndex::addToIndices(int slot)
+{
+	const Entry& entry = *entries[slot];
+	slotsByFile.add(entry.description.fileOrIdentifier, slot);
+	slotsByManufacturer.add(entry.manufacturer, slot);
+	slotsByCategory.add(entry.category, slot);
+	slotsByFormat.add(entry.formatName, slot);
+	slotsByName.insert(findNamePosition(entry.name, slot), slot);
+}
+
+/**
+*Removes a plugin from the file, manufacturer, category, format and name indices.
+*/
+void PluginIndex::removeFromIndices(int slot)
+{
+	const Entry& entry = *entries[slot];
+	slotsByFile.remove(entry.description.fileOrIdentifier, slot);
+	slotsByManufacturer.remove(entry.manufacturer, slot);
+	slotsByCategory.remove(entry.category, slot);
+	slotsByFormat.remove(entry.formatName, slot);
+
+	const int position = findNamePosition(entry.name, slot);
+
+	if (position < slotsByName.size() && slotsByName[position] == slot)
+		slotsByName.remove(position);
+}
+
+/**
+*Binary searches the name index for the first plugin not ordered before a name, with slots breaking ties.
+*@param name The lowercase name.
+*@param slot The slot to order by among plugins with the same name. Pass -1 to find the first plugin with the name.
+*@return The position in the name index.
+*/
+int PluginIndex::findNamePosition(const String& name, int slot) const
+{
+	int start = 0;
+	int end = slotsByName.size();
+
+	while (start < end)
+	{
+		const int middle = (start + end) / 2;
+		const int other = slotsByName[middle];
+		const int order = entries[other]->name.compare(name);
+
+		if (order < 0 || (order == 0 && other < slot))
+			start = middle + 1;
+		else
+			end = middle;
+	}
+
+	return start;
+}
+
+/**
+*Checks wether a plugin matches a filter. The strings are the lowercase strings of the filter.
+*/
+bool PluginIndex::matches(const Entry& entry, const PluginQuery& filter, const String& namePrefix, const String& manufacturer, const String& category, const String& formatName) const
+{
+	const PluginDescription& description = entry.description;
+
+	if (filter.kind == PluginQuery::instrumentsOnly && !description.isInstrument)
+		return false;
+
+	if (filter.kind == PluginQuery::effectsOnly && description.isInstrument)
+		return false;
+
+	if (filter.numInputChannels >= 0 && description.numInputChannels != filter.numInputChannels)
+		return false;
+
+	if (filter.numOutputChannels >= 0 && description.numOutputChannels != filter.numOutputChannels)
+		return false;
+
+	return (namePrefix.isEmpty() || entry.name.startsWith(namePrefix))
+		&& (manufacturer.isEmpty() || entry.manufacturer == manufacturer)
+		&& (category.isEmpty() || entry.category == category)
+		&& (formatName.isEmpty() || entry.formatName == formatName);
+}
+
+/**
+*Checks wether two descriptions of the same plugin agree on everything the index stores.
+*/
+bool PluginIndex::describesSamePlugin(const PluginDescription& a, const PluginDescription& b)
+{
+	return a.name == b.name
+		&& a.descriptiveName == b.descriptiveName
+		&& a.pluginFormatName == b.pluginFormatName
+		&& a.category == b.category
+		&& a.manufacturerName == b.manufacturerName
+		&& a.version == b.version
+		&& a.fileOrIdentifier == b.fileOrIdentifier
+		&& a.lastFileModTime == b.lastFileModTime
+		&& a.uid == b.uid
+		&& a.isInstrument == b.isInstrument
+		&& a.numInputChannels == b.numInputChannels
+		&& a.numOutputChannels == b.numOutputChannels
+		&& a.hasSharedContainer == b.hasSharedContainer;
+}
+
+/**
+*Gets the slots stored under a key.
+*@return The slots, or nullptr if nothing was stored under the key since the buckets were last cleared.
+*/
+const Array<int>* PluginIndex::Buckets::find(const String& key) const
+{
+	return bucketIndices.contains(key) ? buckets[bucketIndices[key]] : nullptr;
+}
+
+/**
+*Stores a slot under a key.
+*/
+void PluginIndex::Buckets::add(const String& key, int slot)
+{
+	if (!bucketIndices.contains(key))
+	{
+		bucketIndices.set(key, buckets.size());
+		buckets.add(new Array<int>());
+	}
+
+	buckets[bucketIndices[key]]->add(slot);
+}
+
+/**
+*Removes a slot stored under a key. The bucket is kept, as the same key usually comes back on the next scan.
+*/
+void PluginIndex::Buckets::remove(const String& key, int slot)
+{
+	if (bucketIndices.contains(key))
+		buckets[bucketIndices[key]]->removeFirstMatchingValue(slot);
+}
+
+/**
+*Removes every key and its bucket.
+*/
+void PluginIndex::Buckets::clear()
+{
+	bucketIndices.clear();
+	buckets.clear();
+}
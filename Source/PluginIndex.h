@@ -0,0 +1,132 @@
+/*
+	==============================================================================
+
+	PluginIndex
+	by Daniel Rothmann
+
+	Secondary indices over the known plugins, for fast lookups and filtered queries
+
+	==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/**
+* A filter for querying plugins, laid out for passing across the C API. Null strings and negative numbers match anything.
+* Strings are UTF-8 and compared without case. The name matches by prefix, the other strings exactly.
+*/
+struct PluginQuery
+{
+	enum Kind
+	{
+		anyKind = 0,
+		instrumentsOnly = 1,
+		effectsOnly = 2
+	};
+
+	const char* namePrefix;
+	const char* manufacturer;
+	const char* category;
+	const char* formatName;
+	int32 kind;
+	int32 numInputChannels;
+	int32 numOutputChannels;
+};
+
+/**
+* A compact description of a plugin matching a query, laid out for copying across the C API.
+*/
+struct PluginQueryResult
+{
+	enum Flags
+	{
+		instrument = 1,
+		sharedContainer = 2
+	};
+
+	int32 handle;
+	int32 uid;
+	int32 numInputChannels;
+	int32 numOutputChannels;
+	int32 flags;
+};
+
+/**
+* Secondary indices over the known plugins. Every plugin gets a stable integer handle, which stays valid until the
+* plugin leaves the index. Plugins are indexed by identifier key, file, manufacturer, category and format in hash
+* maps, and by name in a sorted array, all of which are updated as plugins are added and removed one by one.
+* The slots of removed plugins are reused, and a handle carries the generation of its slot, so a stale handle doesn't
+* refer to the plugin which took the slot over. Identifier strings are matched like KnownPluginList matches them: by the
+* file hash and uid they end with, ignoring case, so identifiers saved with another name prefix or case still match.
+*/
+class PluginIndex
+{
+public:
+	PluginIndex();
+	~PluginIndex();
+
+	int add(const PluginDescription& description);
+	void remove(const String& identifier);
+	void removeFile(const String& fileOrIdentifier);
+	void clear();
+
+	const PluginDescription* getDescription(int handle) const;
+	int getHandleForIdentifier(const String& identifier) const;
+	int getHandleForFile(const String& fileOrIdentifier) const;
+	int query(const PluginQuery& filter, PluginQueryResult* results, int capacity) const;
+
+	static String createIdentifierKey(const String& identifier);
+
+private:
+	struct Entry
+	{
+		PluginDescription description;
+		String identifierKey;
+		String name;
+		String manufacturer;
+		String category;
+		String formatName;
+		int generation = 0;
+		bool inUse = false;
+	};
+
+	/**
+	* Lists of handles keyed by a string, such as all plugins of one manufacturer.
+	*/
+	class Buckets
+	{
+	public:
+		const Array<int>* find(const String& key) const;
+		void add(const String& key, int slot);
+		void remove(const String& key, int slot);
+		void clear();
+
+	private:
+		HashMap<String, int> bucketIndices;
+		OwnedArray<Array<int>> buckets;
+	};
+
+	int makeHandle(int slot) const;
+	int findSlot(int handle) const;
+	void removeSlot(int slot);
+	void setFields(Entry& entry, const PluginDescription& description);
+	void addToIndices(int slot);
+	void removeFromIndices(int slot);
+	int findNamePosition(const String& name, int slot) const;
+	bool matches(const Entry& entry, const PluginQuery& filter, const String& namePrefix, const String& manufacturer, const String& category, const String& formatName) const;
+
+	static bool describesSamePlugin(const PluginDescription& a, const PluginDescription& b);
+
+	// The low bits of a handle hold the slot, and the bits above it the generation of the slot.
+	static const int slotBits = 20;
+
+	OwnedArray<Entry> entries;
+	Array<int> freeSlots;
+	HashMap<String, int> slotsByIdentifier;
+	Buckets slotsByFile;
+	Buckets slotsByManufacturer;
+	Buckets slotsByCategory;
+	Buckets slotsByFormat;
+	Array<int> slotsByName;
+};
@@ -0,0 +1,373 @@
+/*
+	==============================================================================
+
+	PluginInstanceCache
+	by Daniel Rothmann
+
+	A warm pool of prepared plugin hosts handed out per plugin and preset
+
+	==============================================================================
+*/
+
+#include "PluginInstanceCache.h"
+
+/**
+*Constructs an empty cache and starts its refill thread.
+*@param idleInstances The number of prepared hosts to keep ready for each preset.
+*/
+PluginInstanceCache::PluginInstanceCache(int idleInstances)
+	: Thread("PluginInstanceCache refill"), idleInstancesPerPreset(jmax(0, idleInstances))
+{
+	startThread(4);
+}
+
+PluginInstanceCache::~PluginInstanceCache()
+{
+	signalThreadShouldExit();
+	workAvailable.signal();
+	stopThread(-1);
+
+	// Hosts still checked out belong to the caller from here on.
+}
+
+/**
+*Registers a plugin with a preset, which the refill thread starts preparing idle hosts for.
+*Registering the same plugin, state and playback settings again returns the existing preset.
+*@param xmlPluginDescription A string containing the XML Document which can be read as a PluginDescription.
+*@param stateData A binary state blob from the plugin's getStateInformation. May be null for the default state.
+*@param stateSize The size of stateData in bytes.
+*@param sampleRate The sample rate to prepare hosts with.
+*@param bufferSize The buffer size to prepare hosts with.
+*@return The id of the preset. If the description can't be read, -1 is returned.
+*/
+int PluginInstanceCache::addPreset(char* xmlPluginDescription, const void* stateData, int stateSize, double sampleRate, int bufferSize)
+{
+	PluginDescription description;
+	ScopedPointer<XmlElement> element = XmlDocument::parse(String(xmlPluginDescription));
+
+	if (element == nullptr || !description.loadFromXml(*element))
+		return -1;
+
+	if (stateData == nullptr)
+		stateSize = 0;
+
+	const String pluginIdentifier = description.createIdentifierString();
+	const uint64 presetHash = hashState(stateData, stateSize);
+
+	const ScopedLock lock(cacheLock);
+
+	for (auto* entry : entries)
+	{
+		if (entry->presetHash == presetHash && entry->sampleRate == sampleRate && entry->bufferSize == bufferSize
+			&& entry->pluginIdentifier == pluginIdentifier && entry->state.matches(stateData, (size_t) stateSize))
+			return entry->presetId;
+	}
+
+	Entry::Ptr entry = new Entry();
+	entry->presetId = nextPresetId++;
+	entry->pluginIdentifier = pluginIdentifier;
+	entry->presetHash = presetHash;
+	entry->xmlPluginDescription = String(xmlPluginDescription);
+	entry->state.append(stateData, (size_t) stateSize);
+	entry->sampleRate = sampleRate;
+	entry->bufferSize = bufferSize;
+	entries.add(entry);
+
+	workAvailable.signal();
+	return entry->presetId;
+}
+
+/**
+*Hands out a prepared host with the state of a preset. The host belongs to the caller until it is checked in again.
+*If no idle host is ready, one is created on the calling thread.
+*@param presetId The id returned by addPreset.
+*@return The host. If the preset is unknown or the plugin can't be instantiated, nullptr is returned.
+*/
+PluginHost* PluginInstanceCache::checkout(int presetId)
+{
+	Entry::Ptr entry;
+	ScopedPointer<PluginHost> host;
+
+	{
+		const ScopedLock lock(cacheLock);
+		entry = findEntry(presetId);
+
+		if (entry == nullptr)
+			return nullptr;
+
+		if (!entry->idleHosts.isEmpty())
+			host = entry->idleHosts.removeAndReturn(entry->idleHosts.size() - 1);
+	}
+
+	MemoryBlock defaultState;
+
+	if (host == nullptr)
+		host = createHost(*entry, defaultState);
+
+	if (host == nullptr)
+		return nullptr;
+
+	const ScopedLock lock(cacheLock);
+	rememberDefaultState(*entry, defaultState);
+	checkedOutHosts.add({ host.get(), entry });
+	workAvailable.signal();
+	return host.release();
+}
+
+/**
+*Returns a checked out host to the cache, where it is restored to its preset in the background.
+*An editor the caller opened is closed first, on the message thread, as the refill thread must not delete components.
+*@param host A host returned by checkout.
+*@return Wether the host came from this cache. Hosts of presets which have been cleared are deleted.
+*/
+bool PluginInstanceCache::checkin(PluginHost* host)
+{
+	{
+		const ScopedLock lock(cacheLock);
+		bool isCheckedOut = false;
+
+		for (auto& checkedOut : checkedOutHosts)
+			isCheckedOut = isCheckedOut || checkedOut.host == host;
+
+		if (!isCheckedOut)
+			return false;
+	}
+
+	// Closing may wait for the message thread, so the lock isn't held meanwhile.
+	host->closeEditor();
+
+	ScopedPointer<PluginHost> hostToDelete;
+	const ScopedLock lock(cacheLock);
+
+	for (int i = 0; i < checkedOutHosts.size(); i++)
+	{
+		if (checkedOutHosts.getReference(i).host == host)
+		{
+			const CheckedOutHost checkedOut = checkedOutHosts.removeAndReturn(i);
+
+			if (entries.contains(checkedOut.entry))
+			{
+				returnedHosts.add(checkedOut);
+				workAvailable.signal();
+			}
+			else
+			{
+				hostToDelete = host;
+			}
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+*Gets the number of prepared hosts ready to be checked out for a preset.
+*@param presetId The id returned by addPreset.
+*@return The number of idle hosts. If the preset is unknown, 0 is returned.
+*/
+int PluginInstanceCache::getNumIdleInstances(int presetId)
+{
+	const ScopedLock lock(cacheLock);
+	Entry* entry = findEntry(presetId);
+	return entry != nullptr ? entry->idleHosts.size() : 0;
+}
+
+/**
+*Forgets every preset and deletes the idle hosts. Checked out hosts are deleted when they are checked in.
+*/
+void PluginInstanceCache::clear()
+{
+	ReferenceCountedArray<Entry> clearedEntries;
+	Array<CheckedOutHost> clearedHosts;
+
+	{
+		const ScopedLock lock(cacheLock);
+		clearedEntries.swapWith(entries);
+		clearedHosts.swapWith(returnedHosts);
+	}
+
+	// The hosts are deleted here, outside the lock.
+	for (auto& returned : clearedHosts)
+		delete returned.host;
+}
+
+/**
+*Restores returned hosts and tops presets up with idle hosts until there is nothing left to do, then waits for more.
+*/
+void PluginInstanceCache::run()
+{
+	while (!threadShouldExit())
+	{
+		if (!refillNext())
+			workAvailable.wait(500);
+	}
+
+	const ScopedLock lock(cacheLock);
+
+	for (auto& returned : returnedHosts)
+		delete returned.host;
+
+	returnedHosts.clear();
+}
+
+/**
+*Does one piece of background work: restoring a returned host if there is one, otherwise creating a host for the emptiest preset.
+*@return Wether there was any work to do.
+*/
+bool PluginInstanceCache::refillNext()
+{
+	ScopedPointer<PluginHost> host;
+	Entry::Ptr entry;
+	bool restoring = false;
+
+	{
+		const ScopedLock lock(cacheLock);
+
+		if (!returnedHosts.isEmpty())
+		{
+			const CheckedOutHost returned = returnedHosts.removeAndReturn(returnedHosts.size() - 1);
+			host = returned.host;
+			entry = returned.entry;
+			restoring = true;
+		}
+		else
+		{
+			for (auto* candidate : entries)
+			{
+				if (!candidate->failed && candidate->idleHosts.size() + candidate->numPending < idleInstancesPerPreset)
+				{
+					entry = candidate;
+					entry->numPending++;
+					break;
+				}
+			}
+
+			if (entry == nullptr)
+				return false;
+		}
+	}
+
+	MemoryBlock defaultState;
+
+	if (restoring)
+		restoreHost(*host, *entry);
+	else
+		host = createHost(*entry, defaultState);
+
+	const ScopedLock lock(cacheLock);
+
+	if (!restoring)
+	{
+		entry->numPending--;
+		entry->failed = host == nullptr;
+		rememberDefaultState(*entry, defaultState);
+	}
+
+	// Hosts of presets which have been cleared, or which are no longer needed, are deleted on leaving.
+	if (host != nullptr && entries.contains(entry) && entry->idleHosts.size() < idleInstancesPerPreset)
+		entry->idleHosts.add(host.release());
+
+	return true;
+}
+
+/**
+*Finds a registered preset. Must be called with the cache locked.
+*@param presetId The id returned by addPreset.
+*@return The entry of the preset, or nullptr if it is unknown.
+*/
+PluginInstanceCache::Entry* PluginInstanceCache::findEntry(int presetId)
+{
+	for (auto* entry : entries)
+	{
+		if (entry->presetId == presetId)
+			return entry;
+	}
+
+	return nullptr;
+}
+
+/**
+*Instantiates a headless host for a preset, restores the preset state and prepares it for playback.
+*@param entry The preset to create a host for.
+*@param defaultState Receives the state of the freshly instantiated plugin if the preset has no state of its own.
+*@return The host, or nullptr if the plugin couldn't be instantiated.
+*/
+PluginHost* PluginInstanceCache::createHost(const Entry& entry, MemoryBlock& defaultState)
+{
+	ScopedPointer<PluginHost> host = new PluginHost();
+	host->setHeadless(true);
+
+	if (!host->instantiatePlugin(entry.xmlPluginDescription.toRawUTF8(), entry.sampleRate, entry.bufferSize))
+		return nullptr;
+
+	if (entry.state.getSize() > 0)
+	{
+		host->setState(entry.state.getData(), (int) entry.state.getSize(), false);
+	}
+	else
+	{
+		defaultState.setSize((size_t) host->getStateSize(false));
+		host->getState(defaultState.getData(), (int) defaultState.getSize(), false);
+	}
+
+	host->prepareToPlay(entry.sampleRate, entry.bufferSize);
+	return host.release();
+}
+
+/**
+*Keeps the state a new host had before any caller used it, for presets without a state of their own.
+*Must be called with the cache locked, before the host is handed out, so it is set before any host of the preset is restored.
+*@param entry The preset the host was created for.
+*@param defaultState The state captured by createHost.
+*/
+void PluginInstanceCache::rememberDefaultState(Entry& entry, MemoryBlock& defaultState)
+{
+	if (entry.state.getSize() > 0 || entry.defaultStateCaptured)
+		return;
+
+	entry.defaultState.swapWith(defaultState);
+	entry.defaultStateCaptured = true;
+}
+
+/**
+*Clears what a caller left behind in a host: every mode it switched, its preset bank, parameter changes it scheduled but
+*never processed, its internal state and its parameters, which are restored from the state of the preset, or from the state
+*the plugin started with if the preset has none.
+*@param host The host to restore.
+*@param entry The preset the host belongs to.
+*/
+void PluginInstanceCache::restoreHost(PluginHost& host, const Entry& entry)
+{
+	const MemoryBlock& state = entry.state.getSize() > 0 ? entry.state : entry.defaultState;
+
+	host.setHeadless(true);
+	host.clearScheduledValues();
+
+	// Resetting the modes leaves the plugin released, so it is only prepared once, after its state is restored.
+	host.resetModes();
+	host.resetPlugin();
+
+	if (state.getSize() > 0)
+		host.setState(state.getData(), (int) state.getSize(), false);
+
+	host.prepareToPlay(entry.sampleRate, entry.bufferSize);
+}
+
+/**
+*Hashes a state blob with 64-bit FNV-1a.
+*/
+uint64 PluginInstanceCache::hashState(const void* data, int size)
+{
+	const uint8* bytes = static_cast<const uint8*>(data);
+	uint64 hash = 14695981039346656037ull;
+
+	for (int i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
@@ -0,0 +1,75 @@
+/*
+	==============================================================================
+
+	PluginInstanceCache
+	by Daniel Rothmann
+
+	A warm pool of prepared plugin hosts handed out per plugin and preset
+
+	==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PluginHost.h"
+
+/**
+* A warm pool of prepared, idle plugin hosts, keyed by plugin identifier and a hash of the preset state.
+* Checking out a host only takes it off a list. Returned hosts are reset and restored from the cached
+* binary state of their preset in the background, where a thread also tops every preset up to the
+* configured number of idle hosts.
+*/
+class PluginInstanceCache : private Thread
+{
+public:
+	PluginInstanceCache(int idleInstances);
+	~PluginInstanceCache();
+
+	int addPreset(char* xmlPluginDescription, const void* stateData, int stateSize, double sampleRate, int bufferSize);
+	PluginHost* checkout(int presetId);
+	bool checkin(PluginHost* host);
+
+	int getNumIdleInstances(int presetId);
+	void clear();
+
+private:
+	struct Entry : public ReferenceCountedObject
+	{
+		typedef ReferenceCountedObjectPtr<Entry> Ptr;
+
+		int presetId;
+		String pluginIdentifier;
+		uint64 presetHash;
+		String xmlPluginDescription;
+		MemoryBlock state;
+		MemoryBlock defaultState;
+		bool defaultStateCaptured = false;
+		double sampleRate;
+		int bufferSize;
+		OwnedArray<PluginHost> idleHosts;
+		int numPending = 0;
+		bool failed = false;
+	};
+
+	struct CheckedOutHost
+	{
+		PluginHost* host;
+		Entry::Ptr entry;
+	};
+
+	void run() override;
+	bool refillNext();
+	Entry* findEntry(int presetId);
+	static PluginHost* createHost(const Entry& entry, MemoryBlock& defaultState);
+	static void rememberDefaultState(Entry& entry, MemoryBlock& defaultState);
+	static void restoreHost(PluginHost& host, const Entry& entry);
+	static uint64 hashState(const void* data, int size);
+
+	const int idleInstancesPerPreset;
+	ReferenceCountedArray<Entry> entries;
+	Array<CheckedOutHost> checkedOutHosts;
+	Array<CheckedOutHost> returnedHosts;
+	int nextPresetId = 0;
+	CriticalSection cacheLock;
+	WaitableEvent workAvailable;
+};
@@ -0,0 +1,360 @@
+/*
+	==============================================================================
+
+	PluginScanner
+	by Daniel Rothmann
+
+	Crash-isolated plugin scanning spread across a pool of worker processes
+
+	==============================================================================
+*/
+
+#include "PluginScanner.h"
+
+namespace
+{
+	const char* const scanWorkerId = "MiniPluginHostScanWorker";
+
+	// Sent to a freshly launched worker, which echoes it to prove it is a scan worker.
+	const char* const handshakeMessage = "MiniPluginHostScanHandshake";
+
+	// How long a worker may go without answering pings before it counts as gone.
+	const int pingTimeoutMilliseconds = 5000;
+
+	/**
+	* The child side of a scan: loads each file it is sent with the VST3 format, on the message thread,
+	* and answers with the descriptions it found as XML.
+	*/
+	class ScanWorkerProcess : public ChildProcessSlave
+	{
+	public:
+		void handleMessageFromMaster(const MemoryBlock& message) override
+		{
+			const String file = message.toString();
+
+			if (file == handshakeMessage)
+			{
+				sendMessageToMaster(message);
+				return;
+			}
+
+			// Plugins expect to be loaded on the message thread, and the connection thread has to keep answering pings.
+			MessageManager::callAsync([this, file]
+			{
+				OwnedArray<PluginDescription> found;
+				format.findAllTypesForFile(found, file);
+
+				XmlElement results("SCANRESULTS");
+
+				for (auto* description : found)
+					results.addChildElement(description->createXml());
+
+				const String reply = results.createDocument("", true, false);
+				sendMessageToMaster(MemoryBlock(reply.toRawUTF8(), reply.getNumBytesAsUTF8()));
+			});
+		}
+
+		void handleConnectionLost() override
+		{
+			MessageManager::getInstance()->stopDispatchLoop();
+		}
+
+	private:
+		VST3PluginFormat format;
+	};
+}
+
+/**
+* The parent side of the connection to one worker process.
+*/
+class PluginScanner::WorkerConnection : public ChildProcessMaster
+{
+public:
+	enum Outcome
+	{
+		replied,
+		lost,
+		timedOut
+	};
+
+	/**
+	*Sends a file to the worker and waits for its answer.
+	*@param file The path of the file to scan.
+	*@param timeoutMilliseconds How long to wait for the worker.
+	*@return Wether the worker answered, went away or took too long.
+	*/
+	Outcome scan(const String& file, int timeoutMilliseconds)
+	{
+		answered.reset();
+
+		if (connectionLost || !sendMessageToSlave(MemoryBlock(file.toRawUTF8(), file.getNumBytesAsUTF8())))
+			return lost;
+
+		if (!answered.wait(timeoutMilliseconds))
+			return timedOut;
+
+		return connectionLost ? lost : replied;
+	}
+
+	/**
+	*Checks that the launched process is a scan worker, by having it echo the handshake.
+	*@param timeoutMilliseconds How long to wait for the worker.
+	*@return Wether the worker answered the handshake.
+	*/
+	bool handshake(int timeoutMilliseconds)
+	{
+		const String message(handshakeMessage);
+		return scan(message, timeoutMilliseconds) == replied && reply.toString() == message;
+	}
+
+	void handleMessageFromSlave(const MemoryBlock& message) override
+	{
+		reply = message;
+		answered.signal();
+	}
+
+	void handleConnectionLost() override
+	{
+		connectionLost = true;
+		answered.signal();
+	}
+
+	MemoryBlock reply;
+
+private:
+	WaitableEvent answered;
+	std::atomic<bool> connectionLost { false };
+};
+
+/**
+*Constructs a scanner using a pool of worker processes.
+*@param executable The executable launched for each worker, which has to call RunPluginScanWorker.
+*@param workers The number of worker processes scanning at the same time.
+*@param timeout How long a worker may take for one file before it is killed and the file is blacklisted, in milliseconds.
+*/
+PluginScanner::PluginScanner(const File& executable, int workers, int timeout)
+	: workerExecutable(executable), numWorkers(jmax(1, workers)), timeoutMilliseconds(jmax(1, timeout))
+{
+}
+
+PluginScanner::~PluginScanner()
+{
+}
+
+/**
+*Scans files in the worker processes and adds the plugins found to a list. Blocks until every file has been scanned.
+*Files which crash a worker or time out are added to the blacklist of the list.
+*@param filesToScan The paths of the files to scan.
+*@param list The list to add the found plugins to.
+*@return The number of plugins found.
+*/
+int PluginScanner::scanFiles(const StringArray& filesToScan, KnownPluginList& list)
+{
+	files = filesToScan;
+	nextFile = 0;
+	returnedFiles.clear();
+	scannedFiles.clear();
+	currentList = &list;
+	numPluginsFound = 0;
+	numFailedFiles = 0;
+
+	OwnedArray<Worker> workers;
+
+	for (int i = 0; i < jmin(numWorkers, files.size()); i++)
+		workers.add(new Worker(*this, i))->startThread();
+
+	for (auto* worker : workers)
+		worker->waitForThreadToExit(-1);
+
+	// Files left over because no worker process could be launched. They are neither scanned nor blacklisted.
+	numFailedFiles += files.size() - jmin(files.size(), nextFile.load()) + returnedFiles.size();
+	currentList = nullptr;
+	return numPluginsFound;
+}
+
+/**
+*Gets the number of files which crashed a worker, timed out, gave an unreadable answer or couldn't be handed to a worker during the last scan.
+*@return The number of failed files.
+*/
+int PluginScanner::getNumFailedFiles()
+{
+	const ScopedLock lock(resultLock);
+	return numFailedFiles;
+}
+
+/**
+*Gets the files of the last scan which a worker answered for, or which were blacklisted. Files which were never scanned,
+*because no worker could be launched, or whose answer couldn't be read, aren't included.
+*@return The paths of the files.
+*/
+StringArray PluginScanner::getScannedFiles()
+{
+	const ScopedLock lock(resultLock);
+	return scannedFiles;
+}
+
+/**
+*Runs the current process as a scan worker, if it was launched as one. Returns when the scanner disconnects.
+*@param commandLine The command line the process was launched with.
+*@return Wether the process was launched as a scan worker.
+*/
+bool PluginScanner::runWorker(const String& commandLine)
+{
+	ScopedJuceInitialiser_GUI juceInitialiser;
+	ScanWorkerProcess worker;
+
+	if (!worker.initialiseFromCommandLine(commandLine, scanWorkerId))
+		return false;
+
+	MessageManager::getInstance()->runDispatchLoop();
+	return true;
+}
+
+/**
+*Takes the next file to scan, preferring files given back by workers which couldn't be launched.
+*@param file Receives the path of the file.
+*@return Wether there was a file left.
+*/
+bool PluginScanner::claimFile(String& file)
+{
+	{
+		const ScopedLock lock(resultLock);
+
+		if (!returnedFiles.isEmpty())
+		{
+			file = returnedFiles[returnedFiles.size() - 1];
+			returnedFiles.remove(returnedFiles.size() - 1);
+			return true;
+		}
+	}
+
+	const int index = nextFile.fetch_add(1);
+
+	if (index >= files.size())
+		return false;
+
+	file = files[index];
+	return true;
+}
+
+/**
+*Gives a claimed file back for the other workers, because the claiming worker couldn't be launched.
+*@param file The path of the file.
+*/
+void PluginScanner::returnFile(const String& file)
+{
+	const ScopedLock lock(resultLock);
+	returnedFiles.add(file);
+}
+
+/**
+*Parses the answer of a worker and adds the plugins in it to the list.
+*@param file The path of the scanned file.
+*@param reply The XML answer of the worker.
+*/
+void PluginScanner::addResults(const String& file, const MemoryBlock& reply)
+{
+	ScopedPointer<XmlElement> results = XmlDocument::parse(reply.toString());
+	const ScopedLock lock(resultLock);
+
+	if (results == nullptr)
+	{
+		numFailedFiles++;
+		return;
+	}
+
+	scannedFiles.add(file);
+
+	forEachXmlChildElement(*results, element)
+	{
+		PluginDescription description;
+
+		if (description.loadFromXml(*element))
+		{
+			currentList->addType(description);
+			numPluginsFound++;
+		}
+	}
+}
+
+/**
+*Blacklists a file which crashed a worker or took too long.
+*@param file The path of the file.
+*/
+void PluginScanner::addFailure(const String& file)
+{
+	const ScopedLock lock(resultLock);
+	currentList->addToBlacklist(file);
+	scannedFiles.add(file);
+	numFailedFiles++;
+}
+
+/**
+*Constructs a thread which feeds files to one worker process.
+*@param owner The scanner handing out the files.
+*@param workerIndex The index of the worker.
+*/
+PluginScanner::Worker::Worker(PluginScanner& owner, int workerIndex)
+	: Thread("PluginScanner worker " + String(workerIndex)), scanner(owner)
+{
+}
+
+PluginScanner::Worker::~Worker()
+{
+	stopThread(-1);
+}
+
+/**
+*Takes files from the scanner until there are none left, relaunching the worker process after it crashed or hung.
+*/
+void PluginScanner::Worker::run()
+{
+	String file;
+
+	while (!threadShouldExit() && scanner.claimFile(file))
+	{
+		if (!scanFile(file))
+		{
+			// The worker executable can't be launched, so give the file back and leave the rest to the other workers.
+			scanner.returnFile(file);
+			return;
+		}
+	}
+}
+
+/**
+*Has the worker process scan one file, launching it first if needed.
+*@param file The path of the file to scan.
+*@return Wether the file could be handed to a worker process.
+*/
+bool PluginScanner::Worker::scanFile(const String& file)
+{
+	if (connection == nullptr)
+	{
+		connection = new WorkerConnection();
+
+		// A process which starts but doesn't answer the handshake isn't a scan worker, so it says nothing about the plugin.
+		if (!connection->launchSlaveProcess(scanner.workerExecutable, scanWorkerId, pingTimeoutMilliseconds)
+			|| !connection->handshake(pingTimeoutMilliseconds))
+		{
+			connection = nullptr;
+			return false;
+		}
+	}
+
+	switch (connection->scan(file, scanner.timeoutMilliseconds))
+	{
+		case WorkerConnection::replied:
+			scanner.addResults(file, connection->reply);
+			break;
+
+		case WorkerConnection::lost:
+		case WorkerConnection::timedOut:
+			// Deleting the connection kills the worker process, and the next file gets a fresh one.
+			connection = nullptr;
+			scanner.addFailure(file);
+			break;
+	}
+
+	return true;
+}
@@ -0,0 +1,69 @@
+/*
+	==============================================================================
+
+	PluginScanner
+	by Daniel Rothmann
+
+	Crash-isolated plugin scanning spread across a pool of worker processes
+
+	==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+/**
+* Scans plugin files in a pool of child worker processes, so a plugin which crashes or hangs while being loaded
+* can't take the calling process down with it. Files which crash a worker or time out are blacklisted.
+* The worker executable only has to call RunPluginScanWorker with its command line and exit with its result; see the README
+* for how to build one. A worker has to answer a handshake before files are sent to it, so an executable which isn't a
+* scan worker fails to launch instead of having every file blacklisted.
+*/
+class PluginScanner
+{
+public:
+	PluginScanner(const File& workerExecutable, int numWorkers, int timeoutMilliseconds);
+	~PluginScanner();
+
+	int scanFiles(const StringArray& filesToScan, KnownPluginList& list);
+	int getNumFailedFiles();
+	StringArray getScannedFiles();
+
+	static bool runWorker(const String& commandLine);
+
+private:
+	class WorkerConnection;
+
+	class Worker : public Thread
+	{
+	public:
+		Worker(PluginScanner& owner, int workerIndex);
+		~Worker();
+		void run() override;
+
+	private:
+		bool scanFile(const String& file);
+
+		PluginScanner& scanner;
+		ScopedPointer<WorkerConnection> connection;
+	};
+
+	bool claimFile(String& file);
+	void returnFile(const String& file);
+	void addResults(const String& file, const MemoryBlock& reply);
+	void addFailure(const String& file);
+
+	const File workerExecutable;
+	const int numWorkers;
+	const int timeoutMilliseconds;
+
+	StringArray files;
+	std::atomic<int> nextFile { 0 };
+	StringArray returnedFiles;
+	StringArray scannedFiles;
+	KnownPluginList* currentList = nullptr;
+	CriticalSection resultLock;
+	int numPluginsFound = 0;
+	int numFailedFiles = 0;
+};
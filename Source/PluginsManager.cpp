@@ -26,46 +26,105 @@ PluginsManager::~PluginsManager()
 }
 
 /**
-*Scans a VST plugin and adds it to the list of known plugins.
+*Makes scanning happen in a pool of worker processes, so plugins crashing or hanging while being scanned are blacklisted
+*instead of taking down the process. The worker executable has to pass its command line to RunPluginScanWorker.
+*@param executablePath The path of the worker executable. If empty, plugins are scanned in this process again.
+*@param numWorkers The number of worker processes scanning at the same time.
+*@param timeoutMilliseconds How long scanning one file may take before it is blacklisted.
+*/
+void PluginsManager::setScannerProcess(char* executablePath, int numWorkers, int timeoutMilliseconds)
+{
+	const String path = String(executablePath);
+
+	if (path.isEmpty())
+		scanner = nullptr;
+	else
+		scanner = new PluginScanner(File(path), numWorkers, timeoutMilliseconds);
+}
+
+/**
+*Scans a VST plugin and adds it to the list of known plugins. Files which are unchanged since they were last scanned are skipped.
 *@param filePath The path to the plugin file.
 *@param dontRescanIfAlreadyInList Wether the plugin should be rescanned if it is already in the list of known plugins.
 */
 bool PluginsManager::scanAndAdd(char* filePath, bool dontRescanIfAlreadyInList)
 {
-	return pluginList->scanAndAddFile(filePath, dontRescanIfAlreadyInList, descriptions, *pluginFormat);
+	mergeCatalog();
+	const StringArray files = findFilesToScan(StringArray(String(filePath)), dontRescanIfAlreadyInList);
+	return !files.isEmpty() && scanFiles(files) > 0;
 }
 
+/**
+*Scans a directory for VST plugins and adds them to the list of known plugins. Only files which are new or changed since
+*they were last scanned are loaded, and plugins whose files vanished are removed from the list.
+*@param path The path to the directory.
+*@param dontRescanIfAlreadyInList Wether plugins should be rescanned if they are already in the list of known plugins.
+*@param searchRecursive Wether subdirectories should be searched too.
+*@return Wether the directory contains any known plugins after scanning.
+*/
 bool PluginsManager::scanDirectory(char* path, bool dontRescanIfAlreadyInList, bool searchRecursive)
 {
-	int numPluginsScanned = 0;
 	FileSearchPath searchPath = FileSearchPath(path);
+	const StringArray foundFiles = pluginFormat->searchPathsForPlugins(searchPath, searchRecursive);
 
-	PluginDirectoryScanner* scanner = new PluginDirectoryScanner(	*pluginList, 
-																	*pluginFormat, 
-																	searchPath, 
-																	searchRecursive, 
-																	File());
-	bool shouldSearch = true;
-	String scannedPluginName = "";
+	mergeCatalog();
+	removeVanishedFiles();
+	scanFiles(findFilesToScan(foundFiles, dontRescanIfAlreadyInList));
 
-	while(shouldSearch)
+	for (auto& file : foundFiles)
 	{
-		shouldSearch = scanner->scanNextFile(dontRescanIfAlreadyInList, scannedPluginName);
-
-		if (shouldSearch)
-			numPluginsScanned++;
+		if (hasTypesForFile(file))
+			return true;
 	}
 
-	delete scanner;
-	return numPluginsScanned >= 1; // TODO: This returns false when one correct vst was scanned
+	return false;
 }
 
 /**
-*Rescans all plugins the list of known plugins and blacklists them if issues arise.
+*Rescans the plugins in the list of known plugins whose files changed since they were last scanned, and blacklists them if issues arise.
+*Plugins whose files vanished are removed from the list. Clear the scan cache first to rescan every plugin.
 */
 void PluginsManager::rescanAll()
 {
-	// TODO: Loop through all plugins in list and scan them, blacklist if there are problems.
+	mergeCatalog();
+	removeVanishedFiles();
+
+	StringArray changedFiles;
+
+	for (int i = 0; i < pluginList->getNumTypes(); i++)
+	{
+		const String file = pluginList->getType(i)->fileOrIdentifier;
+
+		if (!scanCache.isUnchanged(file))
+			changedFiles.addIfNotAlreadyThere(file);
+	}
+
+	scanFiles(changedFiles);
+
+	// Files which used to hold plugins but don't load any more are blacklisted too.
+	for (auto& file : changedFiles)
+	{
+		if (!hasTypesForFile(file))
+			pluginList->addToBlacklist(file);
+	}
+}
+
+/**
+*Chooses wether the scan cache fingerprints file content as well, so files which were only touched, for example by
+*deploying them again, aren't rescanned.
+*@param shouldHashContent Wether to hash file content.
+*/
+void PluginsManager::setScanCacheContentHashing(bool shouldHashContent)
+{
+	scanCache.setUsesContentHash(shouldHashContent);
+}
+
+/**
+*Forgets the fingerprints of all scanned files, so every file is loaded again on the next scan.
+*/
+void PluginsManager::clearScanCache()
+{
+	scanCache.clear();
 }
 
 /**
@@ -74,7 +133,12 @@ void PluginsManager::rescanAll()
 */
 void PluginsManager::addToBlacklist(char* pluginID)
 {
-	pluginList->addToBlacklist(String(pluginID));
+	const String identifier = String(pluginID);
+	mergeCatalog();
+
+	// The list drops the plugin matching a blacklisted identifier, which the index matches the same way.
+	index.remove(identifier);
+	pluginList->addToBlacklist(identifier);
 }
 
 /**
@@ -95,20 +159,40 @@ void PluginsManager::clearBlacklist()
 }
 
 /**
-*Parses string as XML element and recreates known plugin list from XML.
+*Parses string as XML element and recreates known plugin list and scan cache from XML.
 */
 void PluginsManager::createListFromXml(char* xmlKnownPluginList)
 {
-	pluginList->recreateFromXml(*convertStringToXmlElement(xmlKnownPluginList));
+	ScopedPointer<XmlElement> xml = convertStringToXmlElement(xmlKnownPluginList);
+
+	if (xml != nullptr)
+	{
+		catalog = nullptr;
+		pluginList->recreateFromXml(*xml);
+
+		if (auto* cache = xml->getChildByName(ScanCache::xmlTagName))
+			scanCache.restoreFromXml(*cache);
+		else
+			scanCache.clear();
+
+		index.clear();
+		catalogIsIndexed = false;
+
+		for (int i = 0; i < pluginList->getNumTypes(); i++)
+			index.add(*pluginList->getType(i));
+	}
 }
 
 /**
-*Formats known plugin list as XML and returns it.
+*Formats known plugin list as XML and returns it, with the scan cache stored next to the plugins.
 *@return A string containing list formatted as XML.
 */
 String PluginsManager::createXmlFromList()
 {
-	return convertXmlElementToString(pluginList->createXml());
+	mergeCatalog();
+	ScopedPointer<XmlElement> xml = pluginList->createXml();
+	xml->addChildElement(scanCache.createXml());
+	return convertXmlElementToString(xml);
 }
 
 /**
@@ -118,14 +202,7 @@ String PluginsManager::createXmlFromList()
 */
 String PluginsManager::getXmlPluginDescriptionForFile(char* filePath)
 {
-	auto description = pluginList->getTypeForFile(filePath);
-
-	if (description)
-	{
-		return convertXmlElementToString(description->createXml());
-	}
-
-	return "";
+	return getXmlPluginDescriptionForHandle(findHandleForFile(String(filePath)));
 }
 
 /**
@@ -135,14 +212,332 @@ String PluginsManager::getXmlPluginDescriptionForFile(char* filePath)
 */
 String PluginsManager::getXmlPluginDescriptionForId(char* pluginID)
 {
-	auto description = pluginList->getTypeForIdentifierString(pluginID);
+	return getXmlPluginDescriptionForHandle(findHandleForIdentifier(String(pluginID)));
+}
+
+/**
+*Writes the list of known plugins and the blacklist to a binary catalog file, which loads much faster than XML.
+*@param path The path of the catalog file.
+*@return Wether the catalog was written.
+*/
+bool PluginsManager::saveCatalog(char* path)
+{
+	mergeCatalog();
+	return PluginCatalog::write(*pluginList, File(String(path)));
+}
+
+/**
+*Replaces the list of known plugins with a binary catalog file. The file is memory-mapped and plugins are looked up
+*in it directly, so nothing is decoded until it is needed. Looking plugins up only decodes the plugins found, and queries
+*index the catalog once without copying it into the list. Scanning or exporting the list merges the catalog into it.
+*The catalog holds no scan cache, so the fingerprints of the previous list are forgotten rather than applied to plugins they weren't taken for.
+*@param path The path of the catalog file.
+*@return Wether the file could be opened as a catalog. If not, the list is left unchanged.
+*/
+bool PluginsManager::openCatalog(char* path)
+{
+	ScopedPointer<PluginCatalog> openedCatalog = new PluginCatalog();
+
+	if (!openedCatalog->open(File(String(path))))
+		return false;
+
+	pluginList->clear();
+	pluginList->clearBlacklistedFiles();
+
+	for (auto& file : openedCatalog->getBlacklistedFiles())
+		pluginList->addToBlacklist(file);
+
+	scanCache.clear();
+	index.clear();
+	catalog = openedCatalog.release();
+	catalogIsIndexed = false;
+	return true;
+}
+
+/**
+*Finds the known plugins matching a filter, for example to search plugins as the user types. The lookup goes through
+*indices by name, manufacturer, category and format instead of walking the whole list. The plugins of an open catalog are
+*indexed on the first query.
+*@param query The filter.
+*@param results An array to fill with compact descriptions of the matching plugins, sorted by name. May be nullptr to only count them.
+*@param capacity The number of results the array can hold.
+*@return The number of matching plugins, which may be larger than the capacity.
+*/
+int PluginsManager::queryPlugins(const PluginQuery& query, PluginQueryResult* results, int capacity)
+{
+	indexCatalog();
+	return index.query(query, results, capacity);
+}
+
+/**
+*Gets the name of a plugin by the handle a query returned.
+*@param handle The handle of the plugin.
+*@return The name of the plugin, or an empty string if the handle is no longer valid.
+*/
+String PluginsManager::getPluginNameForHandle(int handle)
+{
+	auto* description = index.getDescription(handle);
+	return description != nullptr ? description->name : String();
+}
+
+/**
+*Formats the plugin with a handle a query returned as XML.
+*@param handle The handle of the plugin.
+*@return A string containing the plugin description formatted as XML, or an empty string if the handle is no longer valid.
+*/
+String PluginsManager::getXmlPluginDescriptionForHandle(int handle)
+{
+	auto* description = index.getDescription(handle);
+
+	if (description == nullptr)
+		return "";
+
+	ScopedPointer<XmlElement> xml = description->createXml();
+	return convertXmlElementToString(xml);
+}
+
+/**
+*Gets the handle of a plugin by its identifier string, for instantiating it without formatting and parsing its description.
+*@param pluginID The identifier string of the plugin.
+*@return The handle of the plugin, or -1 if it isn't known.
+*/
+int PluginsManager::getHandleForId(char* pluginID)
+{
+	return findHandleForIdentifier(String(pluginID));
+}
+
+/**
+*Gets the handle of the first plugin of a file, for instantiating it without formatting and parsing its description.
+*@param filePath The path of the plugin file.
+*@return The handle of the plugin, or -1 if no plugin of the file is known.
+*/
+int PluginsManager::getHandleForFile(char* filePath)
+{
+	return findHandleForFile(String(filePath));
+}
+
+/**
+*Gets the parsed description of a plugin by its handle. It stays valid until the list of known plugins changes.
+*@param handle The handle of the plugin.
+*@return The description, or nullptr if the handle is no longer valid.
+*/
+const PluginDescription* PluginsManager::getDescriptionForHandle(int handle)
+{
+	return index.getDescription(handle);
+}
+
+/**
+*Removes blacklisted and unchanged files from a list of files to scan. Files the scan cache doesn't know yet are left out
+*if they are already in the list and shouldn't be rescanned.
+*@param files The paths of the files.
+*@param dontRescanIfAlreadyInList Wether files already in the list of known plugins should be left out.
+*@return The paths of the files which should be scanned.
+*/
+StringArray PluginsManager::findFilesToScan(const StringArray& files, bool dontRescanIfAlreadyInList)
+{
+	StringArray filesToScan;
+
+	for (auto& file : files)
+	{
+		if (pluginList->getBlacklistedFiles().contains(file))
+			continue;
+
+		if (scanCache.contains(file))
+		{
+			if (scanCache.isUnchanged(file))
+				continue;
+		}
+		else if (dontRescanIfAlreadyInList && hasTypesForFile(file) && pluginList->isListingUpToDate(file, *pluginFormat))
+		{
+			scanCache.update(file);
+			continue;
+		}
+
+		filesToScan.add(file);
+	}
+
+	return filesToScan;
+}
+
+/**
+*Scans files, in worker processes if a scanner process is set and in this process otherwise, replacing the plugins previously
+*listed for them. Only the fingerprints of files which were actually scanned or blacklisted are remembered. Files the worker
+*processes never got to keep their previous plugins, and are scanned again next time.
+*@param files The paths of the files to scan.
+*@return The number of plugins found.
+*/
+int PluginsManager::scanFiles(const StringArray& files)
+{
+	int numPluginsFound = 0;
+	StringArray scannedFiles = files;
+	OwnedArray<PluginDescription> previousTypes;
+
+	for (int i = 0; i < pluginList->getNumTypes(); i++)
+	{
+		if (files.contains(pluginList->getType(i)->fileOrIdentifier))
+			previousTypes.add(new PluginDescription(*pluginList->getType(i)));
+	}
+
+	for (auto& file : files)
+		removeTypesForFile(file);
+
+	if (scanner != nullptr)
+	{
+		numPluginsFound = scanner->scanFiles(files, *pluginList);
+		scannedFiles = scanner->getScannedFiles();
+
+		for (auto* type : previousTypes)
+		{
+			if (!scannedFiles.contains(type->fileOrIdentifier))
+				pluginList->addType(*type);
+		}
+	}
+	else
+	{
+		for (auto& file : files)
+		{
+			descriptions.clear();
+			pluginList->scanAndAddFile(file, false, descriptions, *pluginFormat);
+			numPluginsFound += descriptions.size();
+		}
+	}
+
+	for (auto& file : scannedFiles)
+		scanCache.update(file);
+
+	for (int i = 0; i < pluginList->getNumTypes(); i++)
+	{
+		if (files.contains(pluginList->getType(i)->fileOrIdentifier))
+			index.add(*pluginList->getType(i));
+	}
+
+	return numPluginsFound;
+}
+
+/**
+*Removes plugins whose files no longer exist from the list of known plugins and from the scan cache.
+*/
+void PluginsManager::removeVanishedFiles()
+{
+	for (int i = pluginList->getNumTypes(); --i >= 0;)
+	{
+		const String file = pluginList->getType(i)->fileOrIdentifier;
+
+		if (File::isAbsolutePath(file) && !File(file).exists())
+		{
+			index.remove(pluginList->getType(i)->createIdentifierString());
+			pluginList->removeType(i);
+		}
+	}
+
+	for (auto& path : scanCache.getPaths())
+	{
+		if (!File::isAbsolutePath(path) || !File(path).exists())
+			scanCache.remove(path);
+	}
+}
+
+/**
+*Removes all plugins of a file from the list of known plugins and from the index.
+*@param file The path of the file.
+*/
+void PluginsManager::removeTypesForFile(const String& file)
+{
+	for (int i = pluginList->getNumTypes(); --i >= 0;)
+	{
+		if (pluginList->getType(i)->fileOrIdentifier == file)
+			pluginList->removeType(i);
+	}
+
+	index.removeFile(file);
+}
+
+/**
+*Decodes every plugin of an open catalog into the list of known plugins and closes the catalog.
+*Called before operations which change or need the whole list. Handles given out for catalog plugins stay valid.
+*/
+void PluginsManager::mergeCatalog()
+{
+	if (catalog == nullptr)
+		return;
 
-	if (description)
+	for (int i = 0; i < catalog->getNumPlugins(); i++)
 	{
-		return convertXmlElementToString(description->createXml());
+		PluginDescription description;
+
+		if (catalog->getPlugin(i, description))
+		{
+			pluginList->addType(description);
+			index.add(description);
+		}
 	}
 
-	return "";
+	catalog = nullptr;
+	catalogIsIndexed = false;
+}
+
+/**
+*Adds every plugin of an open catalog to the index, once, for queries which have to consider all plugins.
+*The catalog stays open and nothing is copied into the list of known plugins.
+*/
+void PluginsManager::indexCatalog()
+{
+	if (catalog == nullptr || catalogIsIndexed)
+		return;
+
+	for (int i = 0; i < catalog->getNumPlugins(); i++)
+	{
+		PluginDescription description;
+
+		if (catalog->getPlugin(i, description))
+			index.add(description);
+	}
+
+	catalogIsIndexed = true;
+}
+
+/**
+*Finds a plugin by its identifier string in the index, or else through the hash index of an open catalog, decoding and
+*indexing only the plugin found.
+*@param identifier The identifier string of the plugin.
+*@return The handle of the plugin, or -1 if it isn't known.
+*/
+int PluginsManager::findHandleForIdentifier(const String& identifier)
+{
+	const int handle = index.getHandleForIdentifier(identifier);
+
+	if (handle >= 0 || catalog == nullptr)
+		return handle;
+
+	PluginDescription description;
+	return catalog->getPlugin(catalog->findPluginForIdentifier(identifier), description) ? index.add(description) : -1;
+}
+
+/**
+*Finds the first plugin of a file in the index, or else through the hash index of an open catalog, decoding and
+*indexing only the plugin found.
+*@param fileOrIdentifier The path of the plugin file.
+*@return The handle of the plugin, or -1 if no plugin of the file is known.
+*/
+int PluginsManager::findHandleForFile(const String& fileOrIdentifier)
+{
+	const int handle = index.getHandleForFile(fileOrIdentifier);
+
+	if (handle >= 0 || catalog == nullptr)
+		return handle;
+
+	PluginDescription description;
+	return catalog->getPlugin(catalog->findPluginForFile(fileOrIdentifier), description) ? index.add(description) : -1;
+}
+
+/**
+*Checks wether the list of known plugins holds any plugin of a file, through the index rather than walking the list.
+*@param file The path of the file.
+*@return Wether a plugin of the file is known.
+*/
+bool PluginsManager::hasTypesForFile(const String& file)
+{
+	return index.getHandleForFile(file) >= 0;
 }
 
 /**
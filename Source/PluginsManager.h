@@ -11,6 +11,10 @@
 
 #pragma once
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "PluginScanner.h"
+#include "ScanCache.h"
+#include "PluginCatalog.h"
+#include "PluginIndex.h"
 
 /**
  * A wrapper class for the JUCE KnownPluginList for C# interop.
@@ -21,23 +25,50 @@ public:
 	PluginsManager();
 	~PluginsManager();
 
+	void setScannerProcess(char* executablePath, int numWorkers, int timeoutMilliseconds);
 	bool scanAndAdd(char* filePath, bool dontRescanIfAlreadyInList);
 	bool scanDirectory(char* path, bool dontRescanIfAlreadyInList, bool searchRecursive);
 	void rescanAll();
 	void addToBlacklist(char* pluginID);
 	void removeFromBlacklist(char* pluginID);
 	void clearBlacklist();
+	void setScanCacheContentHashing(bool shouldHashContent);
+	void clearScanCache();
 
 	void createListFromXml(char* xmlKnownPluginList);
 	String createXmlFromList();
 	String getXmlPluginDescriptionForFile(char* filePath);
 	String getXmlPluginDescriptionForId(char* pluginID);
 
+	bool saveCatalog(char* path);
+	bool openCatalog(char* path);
+
+	int queryPlugins(const PluginQuery& query, PluginQueryResult* results, int capacity);
+	String getPluginNameForHandle(int handle);
+	String getXmlPluginDescriptionForHandle(int handle);
+	int getHandleForId(char* pluginID);
+	int getHandleForFile(char* filePath);
+	const PluginDescription* getDescriptionForHandle(int handle);
+
 private:
 	ScopedPointer<KnownPluginList> pluginList;
 	ScopedPointer<AudioPluginFormat> pluginFormat;
 	OwnedArray<PluginDescription> descriptions;
+	ScopedPointer<PluginScanner> scanner;
+	ScanCache scanCache;
+	ScopedPointer<PluginCatalog> catalog;
+	PluginIndex index;
+	bool catalogIsIndexed = false;
 
+	StringArray findFilesToScan(const StringArray& files, bool dontRescanIfAlreadyInList);
+	int scanFiles(const StringArray& files);
+	void removeVanishedFiles();
+	void removeTypesForFile(const String& file);
+	void mergeCatalog();
+	void indexCatalog();
+	int findHandleForIdentifier(const String& identifier);
+	int findHandleForFile(const String& fileOrIdentifier);
+	bool hasTypesForFile(const String& file);
 	XmlElement* convertStringToXmlElement(char* data);
 	String convertXmlElementToString(XmlElement* element);
 };
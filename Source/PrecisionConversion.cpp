@@ -0,0 +1,65 @@
+/*
+	==============================================================================
+
+	PrecisionConversion
+	by Daniel Rothmann
+
+	Vectorized conversion between single and double precision samples
+
+	==============================================================================
+*/
+
+#include "PrecisionConversion.h"
+
+#if JUCE_INTEL
+ #include <emmintrin.h>
+ #define PRECISION_CONVERSION_USE_SSE 1
+#else
+ #define PRECISION_CONVERSION_USE_SSE 0
+#endif
+
+/**
+*Converts double precision samples to single precision.
+*@param source The samples to convert.
+*@param destination The buffer receiving the converted samples. Must not overlap source.
+*@param numSamples The number of samples to convert.
+*/
+void PrecisionConversion::toFloat(const double* source, float* destination, int numSamples)
+{
+	int sample = 0;
+
+#if PRECISION_CONVERSION_USE_SSE
+	for (; sample + 4 <= numSamples; sample += 4)
+	{
+		const __m128 low = _mm_cvtpd_ps(_mm_loadu_pd(source + sample));
+		const __m128 high = _mm_cvtpd_ps(_mm_loadu_pd(source + sample + 2));
+		_mm_storeu_ps(destination + sample, _mm_movelh_ps(low, high));
+	}
+#endif
+
+	for (; sample < numSamples; sample++)
+		destination[sample] = (float) source[sample];
+}
+
+/**
+*Converts single precision samples to double precision.
+*@param source The samples to convert.
+*@param destination The buffer receiving the converted samples. Must not overlap source.
+*@param numSamples The number of samples to convert.
+*/
+void PrecisionConversion::toDouble(const float* source, double* destination, int numSamples)
+{
+	int sample = 0;
+
+#if PRECISION_CONVERSION_USE_SSE
+	for (; sample + 4 <= numSamples; sample += 4)
+	{
+		const __m128 samples = _mm_loadu_ps(source + sample);
+		_mm_storeu_pd(destination + sample, _mm_cvtps_pd(samples));
+		_mm_storeu_pd(destination + sample + 2, _mm_cvtps_pd(_mm_movehl_ps(samples, samples)));
+	}
+#endif
+
+	for (; sample < numSamples; sample++)
+		destination[sample] = (double) source[sample];
+}
@@ -0,0 +1,22 @@
+/*
+	==============================================================================
+
+	PrecisionConversion
+	by Daniel Rothmann
+
+	Vectorized conversion between single and double precision samples
+
+	==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/**
+* Converts samples between single and double precision, vectorized with SSE2 where available.
+*/
+namespace PrecisionConversion
+{
+	void toFloat(const double* source, float* destination, int numSamples);
+	void toDouble(const float* source, double* destination, int numSamples);
+}
@@ -0,0 +1,250 @@
+/*
+	==============================================================================
+
+	ScanCache
+	by Daniel Rothmann
+
+	Fingerprints of scanned plugin files, for only rescanning what changed on disk
+
+	==============================================================================
+*/
+
+#include "ScanCache.h"
+
+const char* const ScanCache::xmlTagName = "SCANCACHE";
+
+namespace
+{
+	// Only this much of the start and the end of a file is hashed, so hashing stays fast for large binaries.
+	const int64 hashedBytesPerEnd = 65536;
+}
+
+/**
+*Constructs an empty cache.
+*/
+ScanCache::ScanCache()
+{
+}
+
+ScanCache::~ScanCache()
+{
+}
+
+/**
+*Checks wether a file is unchanged since it was scanned. With content hashing, a file whose modification time changed
+*but whose size and content hash still match counts as unchanged, and its new modification time is remembered.
+*@param path The path of the file.
+*@return Wether the file was scanned before and is unchanged. Returns false for files which vanished.
+*/
+bool ScanCache::isUnchanged(const String& path)
+{
+	if (!fingerprints.contains(path))
+		return false;
+
+	const File file(path);
+
+	if (!file.exists())
+		return false;
+
+	Fingerprint cached = fingerprints[path];
+	const Fingerprint current = createFingerprint(file, false);
+
+	if (current.size != cached.size)
+		return false;
+
+	if (current.modificationTime == cached.modificationTime)
+		return true;
+
+	if (!usesContentHash || cached.contentHash == 0 || hashContent(file) != cached.contentHash)
+		return false;
+
+	cached.modificationTime = current.modificationTime;
+	fingerprints.set(path, cached);
+	return true;
+}
+
+/**
+*Checks wether a file has a fingerprint in the cache.
+*@param path The path of the file.
+*@return Wether the file was scanned before.
+*/
+bool ScanCache::contains(const String& path) const
+{
+	return fingerprints.contains(path);
+}
+
+/**
+*Remembers the current fingerprint of a file after it was scanned.
+*@param path The path of the file.
+*/
+void ScanCache::update(const String& path)
+{
+	const File file(path);
+
+	if (file.exists())
+		fingerprints.set(path, createFingerprint(file, usesContentHash));
+	else
+		fingerprints.remove(path);
+}
+
+/**
+*Forgets the fingerprint of a file.
+*@param path The path of the file.
+*/
+void ScanCache::remove(const String& path)
+{
+	fingerprints.remove(path);
+}
+
+/**
+*Forgets all fingerprints, so every file is scanned again.
+*/
+void ScanCache::clear()
+{
+	fingerprints.clear();
+}
+
+/**
+*Gets the paths of all files with a fingerprint in the cache.
+*@return The paths.
+*/
+StringArray ScanCache::getPaths() const
+{
+	StringArray paths;
+
+	for (HashMap<String, Fingerprint>::Iterator i(fingerprints); i.next();)
+		paths.add(i.getKey());
+
+	return paths;
+}
+
+/**
+*Chooses wether fingerprints include a hash of the file content, which keeps files from being rescanned
+*when only their modification time changed, for example after being deployed again.
+*@param shouldUseContentHash Wether to hash file content.
+*/
+void ScanCache::setUsesContentHash(bool shouldUseContentHash)
+{
+	usesContentHash = shouldUseContentHash;
+}
+
+/**
+*Formats the cache as an XML element, for storing next to the known plugin list.
+*@return A new XML element owned by the caller.
+*/
+XmlElement* ScanCache::createXml() const
+{
+	auto* xml = new XmlElement(xmlTagName);
+
+	for (HashMap<String, Fingerprint>::Iterator i(fingerprints); i.next();)
+	{
+		auto* element = xml->createNewChildElement("FILE");
+		element->setAttribute("path", i.getKey());
+		element->setAttribute("size", String(i.getValue().size));
+		element->setAttribute("modified", String(i.getValue().modificationTime));
+		element->setAttribute("hash", String::toHexString((int64) i.getValue().contentHash));
+	}
+
+	return xml;
+}
+
+/**
+*Replaces the cache with fingerprints read from an XML element created by createXml.
+*@param xml The XML element.
+*/
+void ScanCache::restoreFromXml(const XmlElement& xml)
+{
+	clear();
+
+	forEachXmlChildElementWithTagName(xml, element, "FILE")
+	{
+		Fingerprint fingerprint;
+		fingerprint.size = element->getStringAttribute("size").getLargeIntValue();
+		fingerprint.modificationTime = element->getStringAttribute("modified").getLargeIntValue();
+		fingerprint.contentHash = (uint64) element->getStringAttribute("hash").getHexValue64();
+		fingerprints.set(element->getStringAttribute("path"), fingerprint);
+	}
+}
+
+/**
+*Takes the fingerprint of a file. Plugin bundles are directories, so their fingerprint covers every file inside.
+*@param file The file or bundle.
+*@param withContentHash Wether to hash the content as well.
+*@return The fingerprint.
+*/
+ScanCache::Fingerprint ScanCache::createFingerprint(const File& file, bool withContentHash)
+{
+	Fingerprint fingerprint;
+
+	if (file.isDirectory())
+	{
+		Array<File> children;
+		file.findChildFiles(children, File::findFiles, true);
+
+		for (auto& child : children)
+		{
+			fingerprint.size += child.getSize();
+			fingerprint.modificationTime = jmax(fingerprint.modificationTime, child.getLastModificationTime().toMilliseconds());
+		}
+	}
+	else
+	{
+		fingerprint.size = file.getSize();
+		fingerprint.modificationTime = file.getLastModificationTime().toMilliseconds();
+	}
+
+	if (withContentHash)
+		fingerprint.contentHash = hashContent(file);
+
+	return fingerprint;
+}
+
+/**
+*Hashes the start and the end of a file, or of every file in a bundle, with 64-bit FNV-1a.
+*@param file The file or bundle.
+*@return The hash, which is never 0.
+*/
+uint64 ScanCache::hashContent(const File& file)
+{
+	Array<File> files;
+
+	if (file.isDirectory())
+	{
+		file.findChildFiles(files, File::findFiles, true);
+		files.sort();
+	}
+	else
+	{
+		files.add(file);
+	}
+
+	uint64 hash = 14695981039346656037ull;
+	HeapBlock<uint8> chunk((size_t) hashedBytesPerEnd);
+
+	for (auto& child : files)
+	{
+		FileInputStream stream(child);
+
+		if (stream.failedToOpen())
+			continue;
+
+		const int64 size = stream.getTotalLength();
+		const int64 starts[] = { 0, jmax(hashedBytesPerEnd, size - hashedBytesPerEnd) };
+
+		for (int64 start : starts)
+		{
+			if (start >= size || !stream.setPosition(start))
+				continue;
+
+			const int numRead = stream.read(chunk, (int) jmin(hashedBytesPerEnd, size - start));
+
+			for (int i = 0; i < numRead; i++)
+			{
+				hash ^= chunk[i];
+				hash *= 1099511628211ull;
+			}
+		}
+	}
+
+	return hash != 0 ? hash : 1;
+}
@@ -0,0 +1,53 @@
+/*
+	==============================================================================
+
+	ScanCache
+	by Daniel Rothmann
+
+	Fingerprints of scanned plugin files, for only rescanning what changed on disk
+
+	==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/**
+* Remembers a fingerprint of every scanned plugin file: its size, its modification time and optionally a fast
+* hash of its content. Files whose fingerprint still matches don't have to be loaded again. The cache is stored
+* as an element next to the plugins in the XML of the known plugin list.
+*/
+class ScanCache
+{
+public:
+	ScanCache();
+	~ScanCache();
+
+	bool isUnchanged(const String& path);
+	bool contains(const String& path) const;
+	void update(const String& path);
+	void remove(const String& path);
+	void clear();
+	StringArray getPaths() const;
+
+	void setUsesContentHash(bool shouldUseContentHash);
+
+	XmlElement* createXml() const;
+	void restoreFromXml(const XmlElement& xml);
+
+	static const char* const xmlTagName;
+
+private:
+	struct Fingerprint
+	{
+		int64 size = 0;
+		int64 modificationTime = 0;
+		uint64 contentHash = 0;
+	};
+
+	static Fingerprint createFingerprint(const File& file, bool withContentHash);
+	static uint64 hashContent(const File& file);
+
+	HashMap<String, Fingerprint> fingerprints;
+	bool usesContentHash = false;
+};
@@ -0,0 +1,116 @@
+/*
+	==============================================================================
+
+	WorkStealingDeque
+	by Daniel Rothmann
+
+	A fixed-capacity lock-free work-stealing deque of integer work items
+
+	==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+/**
+* A fixed-capacity Chase-Lev work-stealing deque of integer work items.
+* The owning thread pushes and pops at the bottom, while other threads steal from the top.
+* The deque never grows, so it must be reset before more items than its capacity have been pushed.
+*/
+class WorkStealingDeque
+{
+public:
+	WorkStealingDeque() {}
+	~WorkStealingDeque() {}
+
+	/**
+	*Sizes the deque and empties it. Must not be called while other threads use the deque.
+	*@param capacity The number of items which can be pushed between resets.
+	*/
+	void setCapacity(int capacity)
+	{
+		int size = 1;
+		while (size < capacity)
+			size *= 2;
+
+		items.allocate((size_t) size, true);
+		mask = size - 1;
+		reset();
+	}
+
+	/**
+	*Empties the deque. Must not be called while other threads use the deque.
+	*/
+	void reset()
+	{
+		top.store(0);
+		bottom.store(0);
+	}
+
+	/**
+	*Adds an item at the bottom. Must only be called by the owning thread.
+	*/
+	void push(int item)
+	{
+		const int b = bottom.load(std::memory_order_relaxed);
+		items[b & mask].store(item, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	/**
+	*Takes the most recently pushed item. Must only be called by the owning thread.
+	*@return Wether an item was taken.
+	*/
+	bool pop(int& item)
+	{
+		const int b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int t = top.load(std::memory_order_relaxed);
+
+		if (t > b)
+		{
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		item = items[b & mask].load(std::memory_order_relaxed);
+
+		if (t == b)
+		{
+			// Last item, so race any thieves for it.
+			const bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return won;
+		}
+
+		return true;
+	}
+
+	/**
+	*Takes the oldest item. Can be called from any thread.
+	*@return Wether an item was taken.
+	*/
+	bool steal(int& item)
+	{
+		int t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int b = bottom.load(std::memory_order_acquire);
+
+		if (t >= b)
+			return false;
+
+		item = items[t & mask].load(std::memory_order_relaxed);
+		return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+	}
+
+private:
+	HeapBlock<std::atomic<int>> items;
+	int mask = 0;
+	std::atomic<int> top { 0 };
+	std::atomic<int> bottom { 0 };
+
+	JUCE_DECLARE_NON_COPYABLE(WorkStealingDeque)
+};
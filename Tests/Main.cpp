@@ -0,0 +1,38 @@
+/*
+	==============================================================================
+
+	Main
+	by Daniel Rothmann
+
+	Runs the unit tests of MiniPluginHost and exits with a failure code if any of them failed.
+	The scanner tests launch this executable as their scan worker too.
+
+	==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../Source/PluginScanner.h"
+
+int main(int argc, char* argv[])
+{
+	StringArray arguments;
+
+	for (int index = 1; index < argc; index++)
+		arguments.add(argv[index]);
+
+	if (PluginScanner::runWorker(arguments.joinIntoString(" ")))
+		return 0;
+
+	ScopedJuceInitialiser_GUI juceInitialiser;
+
+	UnitTestRunner runner;
+	runner.setAssertOnFailure(false);
+	runner.runAllTests();
+
+	int numFailures = 0;
+
+	for (int index = 0; index < runner.getNumResults(); index++)
+		numFailures += runner.getResult(index)->failures;
+
+	return numFailures > 0 ? 1 : 0;
+}
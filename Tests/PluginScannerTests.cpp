@@ -0,0 +1,126 @@
+/*
+	==============================================================================
+
+	PluginScannerTests
+	by Daniel Rothmann
+
+	Scans the test plugin next to copies of it which crash or hang while being loaded
+
+	==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../Source/PluginScanner.h"
+#include "TestPlugins.h"
+
+/**
+* Scans with the test executable as the worker executable. The test plugin crashes or hangs when loaded from a file
+* whose name contains Crashing or Hanging, so copies named that way stand in for broken plugins.
+*/
+class PluginScannerTests : public UnitTest
+{
+public:
+	PluginScannerTests() : UnitTest("PluginScanner with crashing and hanging plugins") {}
+
+	void runTest() override
+	{
+		const File folder = File::getSpecialLocation(File::tempDirectory).getNonexistentChildFile("MiniPluginHostScannerTests", "", false);
+		folder.createDirectory();
+
+		const File passThrough = copyTestPlugin(folder, "PassThroughPlugin.vst3");
+		const File crashing = copyTestPlugin(folder, "CrashingPlugin.vst3");
+		const File hanging = copyTestPlugin(folder, "HangingPlugin.vst3");
+		const File workerExecutable = File::getSpecialLocation(File::currentExecutableFile);
+
+		beginTest("A single worker is relaunched after crashing and hanging plugins");
+		{
+			StringArray files;
+			files.add(crashing.getFullPathName());
+			files.add(hanging.getFullPathName());
+			files.add(passThrough.getFullPathName());
+			expectBrokenPluginsBlacklisted(workerExecutable, 1, files, passThrough, crashing, hanging);
+		}
+
+		beginTest("Parallel workers blacklist crashing and hanging plugins");
+		{
+			StringArray files;
+			files.add(passThrough.getFullPathName());
+			files.add(crashing.getFullPathName());
+			files.add(hanging.getFullPathName());
+			expectBrokenPluginsBlacklisted(workerExecutable, 3, files, passThrough, crashing, hanging);
+		}
+
+		beginTest("Workers which can't be launched or don't answer the handshake blacklist nothing");
+		{
+			StringArray files;
+			files.add(passThrough.getFullPathName());
+			files.add(crashing.getFullPathName());
+
+			Array<File> notWorkers;
+			notWorkers.add(folder.getChildFile("MissingWorker.exe"));
+			notWorkers.add(File::getSpecialLocation(File::windowsSystemDirectory).getChildFile("hostname.exe"));
+
+			for (auto& executable : notWorkers)
+			{
+				PluginScanner scanner(executable, 2, timeoutMilliseconds);
+				KnownPluginList list;
+
+				expectEquals(scanner.scanFiles(files, list), 0);
+				expectEquals(list.getNumTypes(), 0);
+				expectEquals(list.getBlacklistedFiles().size(), 0);
+				expectEquals(scanner.getNumFailedFiles(), files.size());
+				expectEquals(scanner.getScannedFiles().size(), 0);
+			}
+		}
+
+		folder.deleteRecursively();
+	}
+
+private:
+	/**
+	*Copies the test plugin into a folder under a new file name.
+	*@param folder The folder to copy into.
+	*@param fileName The file name of the copy, which decides wether it crashes or hangs.
+	*@return The copy.
+	*/
+	File copyTestPlugin(const File& folder, const String& fileName)
+	{
+		const File copy = folder.getChildFile(fileName);
+		expect(TestPlugins::getPassThroughPlugin().copyFileTo(copy), "The test plugin wasn't found next to the test executable");
+		return copy;
+	}
+
+	/**
+	*Scans files and checks that only the pass-through plugin was found and only the broken ones were blacklisted.
+	*@param workerExecutable The executable to launch for each worker.
+	*@param numWorkers The number of worker processes.
+	*@param files The files to scan.
+	*@param passThrough The working plugin.
+	*@param crashing The plugin crashing while being loaded.
+	*@param hanging The plugin hanging while being loaded.
+	*/
+	void expectBrokenPluginsBlacklisted(const File& workerExecutable, int numWorkers, const StringArray& files,
+										const File& passThrough, const File& crashing, const File& hanging)
+	{
+		PluginScanner scanner(workerExecutable, numWorkers, timeoutMilliseconds);
+		KnownPluginList list;
+
+		expectEquals(scanner.scanFiles(files, list), 1);
+		expectEquals(list.getNumTypes(), 1);
+
+		if (list.getNumTypes() > 0)
+			expectEquals(list.getType(0)->fileOrIdentifier, passThrough.getFullPathName());
+
+		const StringArray& blacklist = list.getBlacklistedFiles();
+		expect(blacklist.contains(crashing.getFullPathName()), "The crashing plugin wasn't blacklisted");
+		expect(blacklist.contains(hanging.getFullPathName()), "The hanging plugin wasn't blacklisted");
+		expect(!blacklist.contains(passThrough.getFullPathName()), "The working plugin was blacklisted");
+
+		expectEquals(scanner.getNumFailedFiles(), 2);
+		expectEquals(scanner.getScannedFiles().size(), files.size());
+	}
+
+	static constexpr int timeoutMilliseconds = 3000;
+};
+
+static PluginScannerTests pluginScannerTests;
@@ -0,0 +1,177 @@
+/*
+	==============================================================================
+
+	ProcessBlockAllocationTests
+	by Daniel Rothmann
+
+	Checks that steady-state planar processing doesn't allocate on the audio thread
+
+	==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../Source/PluginHost.h"
+#include "TestPlugins.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if JUCE_MSVC && defined (_DEBUG)
+ #include <crtdbg.h>
+#endif
+
+namespace
+{
+	// Only allocations made by the thread being measured are counted, so other threads can't make the tests flaky.
+	thread_local bool countingAllocations = false;
+	std::atomic<int> numAllocations { 0 };
+
+	void countAllocation()
+	{
+		if (countingAllocations)
+			numAllocations++;
+	}
+
+   #if JUCE_MSVC && defined (_DEBUG)
+	/**
+	*Counts allocations made with malloc, which JUCE's HeapBlock uses and the operator new replacements below don't see.
+	*The debug heap only exists in debug builds, so release builds only count operator new.
+	*/
+	int countCrtAllocation(int allocationType, void*, size_t, int, long, const unsigned char*, int)
+	{
+		if (allocationType != _HOOK_FREE)
+			countAllocation();
+
+		return TRUE;
+	}
+   #endif
+
+	/**
+	*Counts the allocations the calling thread makes while running a function.
+	*@param function The function to run.
+	*@return The number of allocations made.
+	*/
+	template <typename Function>
+	int countAllocations(Function&& function)
+	{
+	   #if JUCE_MSVC && defined (_DEBUG)
+		auto previousHook = _CrtSetAllocHook(countCrtAllocation);
+	   #endif
+
+		numAllocations = 0;
+		countingAllocations = true;
+		function();
+		countingAllocations = false;
+
+	   #if JUCE_MSVC && defined (_DEBUG)
+		_CrtSetAllocHook(previousHook);
+	   #endif
+
+		return numAllocations;
+	}
+}
+
+void* operator new(std::size_t size)
+{
+	countAllocation();
+
+	if (void* memory = std::malloc(size > 0 ? size : 1))
+		return memory;
+
+	throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	countAllocation();
+	return std::malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+
+/**
+* Hosts the pass-through test plugin and counts the allocations made by processBlockPlanar once processing has settled.
+*/
+class ProcessBlockAllocationTests : public UnitTest
+{
+public:
+	ProcessBlockAllocationTests() : UnitTest("ProcessBlockPlanar allocations") {}
+
+	void runTest() override
+	{
+		beginTest("Instantiating the test plugin");
+
+		const String description = TestPlugins::createXmlDescription(TestPlugins::getPassThroughPlugin());
+		expect(description.isNotEmpty(), "The test plugin wasn't found next to the test executable");
+
+		PluginHost host;
+		host.setHeadless(true);
+
+		const bool instantiated = host.instantiatePlugin(description.toRawUTF8(), sampleRate, blockSize);
+		expect(instantiated, "The test plugin couldn't be instantiated");
+
+		if (!instantiated)
+			return;
+
+		host.prepareToPlay(sampleRate, blockSize);
+
+		beginTest("Blocks of the prepared size don't allocate");
+		expectEquals(countProcessingAllocations(host, 2, blockSize), 0);
+
+		beginTest("Blocks longer than the prepared size are split without allocating");
+		expectEquals(countProcessingAllocations(host, 2, blockSize * 3 + 17), 0);
+
+		beginTest("Fewer and more channels than the plugin has don't allocate");
+		expectEquals(countProcessingAllocations(host, 1, blockSize), 0);
+		expectEquals(countProcessingAllocations(host, 4, blockSize), 0);
+
+		host.releasePlugin();
+	}
+
+private:
+	/**
+	*Processes blocks of silence and counts the allocations made after a few warm-up blocks, which plugins and
+	*JUCE's VST3 wrapper may use to size their caches.
+	*@param host The host to process with.
+	*@param numChannels The number of channels to pass.
+	*@param numSamples The number of samples in each block.
+	*@return The number of allocations made while processing the counted blocks.
+	*/
+	static int countProcessingAllocations(PluginHost& host, int numChannels, int numSamples)
+	{
+		AudioBuffer<float> buffer(numChannels, numSamples);
+		buffer.clear();
+		float** channels = buffer.getArrayOfWritePointers();
+
+		for (int block = 0; block < numWarmUpBlocks; block++)
+			host.processBlockPlanar(channels, numChannels, numSamples);
+
+		return countAllocations([&]
+		{
+			for (int block = 0; block < numCountedBlocks; block++)
+				host.processBlockPlanar(channels, numChannels, numSamples);
+		});
+	}
+
+	static constexpr double sampleRate = 44100.0;
+	static constexpr int blockSize = 512;
+	static constexpr int numWarmUpBlocks = 4;
+	static constexpr int numCountedBlocks = 64;
+};
+
+static ProcessBlockAllocationTests processBlockAllocationTests;
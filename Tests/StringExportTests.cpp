@@ -0,0 +1,135 @@
+/*
+	==============================================================================
+
+	StringExportTests
+	by Daniel Rothmann
+
+	Drives the string exports of independent plugins managers from many threads at once
+
+	==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../Source/MiniPluginHostApi.h"
+#include <atomic>
+
+/**
+* Gives every thread its own plugins manager holding one plugin with a name no other thread uses, and has all threads
+* read their lists and descriptions through the string exports at the same time. A thread seeing another thread's
+* plugin, or losing its own while it holds a returned string, means string returns still share storage.
+*/
+class StringExportTests : public UnitTest
+{
+public:
+	StringExportTests() : UnitTest("String exports across threads") {}
+
+	void runTest() override
+	{
+		beginTest("Independent managers can be read concurrently");
+
+		std::atomic<int> numMismatches { 0 };
+		OwnedArray<StressThread> threads;
+
+		for (int index = 0; index < numThreads; index++)
+			threads.add(new StressThread(index, numMismatches));
+
+		for (auto* thread : threads)
+			thread->startThread();
+
+		for (auto* thread : threads)
+			expect(thread->waitForThreadToExit(60000), "A stress thread didn't finish");
+
+		expectEquals(numMismatches.load(), 0);
+	}
+
+private:
+	class StressThread : public Thread
+	{
+	public:
+		StressThread(int threadIndex, std::atomic<int>& mismatches)
+			: Thread("StringExportTests " + String(threadIndex)), numMismatches(mismatches)
+		{
+			description.name = pluginNamePrefix + String(threadIndex);
+			description.pluginFormatName = "VST3";
+			description.manufacturerName = "MiniPluginHost";
+			description.fileOrIdentifier = "C:\\StringExportTests\\Plugin" + String(threadIndex) + ".vst3";
+			description.uid = 1000 + threadIndex;
+		}
+
+		void run() override
+		{
+			KnownPluginList list;
+			list.addType(description);
+			ScopedPointer<XmlElement> listXml = list.createXml();
+			const String listText = listXml->createDocument("");
+			const String identifier = description.createIdentifierString();
+
+			PluginsManager* manager = CreatePluginsManager();
+			CreateListFromXml(manager, const_cast<char*>(listText.toRawUTF8()));
+
+			for (int iteration = 0; iteration < numIterations && !threadShouldExit(); iteration++)
+			{
+				// Returned pointers have to keep their contents while other threads make the same calls.
+				const char* listPointer = CreateXmlFromList(manager);
+				Thread::yield();
+				check(String::fromUTF8(listPointer));
+
+				const char* descriptionPointer = GetXmlPluginDescriptionForId(manager, const_cast<char*>(identifier.toRawUTF8()));
+				Thread::yield();
+				check(String::fromUTF8(descriptionPointer));
+
+				check(copyFromBuffer([&](char* out, int capacity) { return CreateXmlFromListToBuffer(manager, out, capacity); }));
+				check(copyFromBuffer([&](char* out, int capacity)
+				{
+					return GetXmlPluginDescriptionForIdToBuffer(manager, const_cast<char*>(identifier.toRawUTF8()), out, capacity);
+				}));
+			}
+
+			DeletePluginsManager(manager);
+		}
+
+	private:
+		/**
+		*Asks a caller-buffer export for the size it needs, then has it fill a buffer of that size.
+		*@param exportFunction Calls the export with a buffer and its capacity, returning the required length.
+		*@return The string the export wrote. If the required length changed in between, an empty string is returned.
+		*/
+		template <typename ExportFunction>
+		static String copyFromBuffer(ExportFunction&& exportFunction)
+		{
+			const int requiredLength = exportFunction(nullptr, 0);
+			HeapBlock<char> buffer((size_t) requiredLength, true);
+
+			if (exportFunction(buffer.getData(), requiredLength) != requiredLength)
+				return "";
+
+			return String::fromUTF8(buffer.getData());
+		}
+
+		/**
+		*Counts a mismatch unless a returned string names this thread's plugin and no other.
+		*@param text The returned string.
+		*/
+		void check(const String& text)
+		{
+			int numPluginNames = 0;
+
+			for (int position = text.indexOf(pluginNamePrefix); position >= 0; position = text.indexOf(position + 1, pluginNamePrefix))
+				numPluginNames++;
+
+			if (numPluginNames != 1 || !text.contains("\"" + description.name + "\""))
+				numMismatches++;
+		}
+
+		PluginDescription description;
+		std::atomic<int>& numMismatches;
+	};
+
+	static constexpr int numThreads = 8;
+	static constexpr int numIterations = 500;
+	static const char* const pluginNamePrefix;
+};
+
+const char* const StringExportTests::pluginNamePrefix = "String Export Test Plugin ";
+
+static StringExportTests stringExportTests;
@@ -0,0 +1,276 @@
+/*
+	==============================================================================
+
+	TestPlugin
+	by Daniel Rothmann
+
+	A minimal VST3 plugin for the tests to host, so they don't depend on any installed plugin.
+	Copies whose file name contains Crashing or Hanging crash or hang while being loaded instead.
+
+	==============================================================================
+*/
+
+#include <windows.h>
+#include <pluginterfaces/base/ipluginbase.h>
+#include <pluginterfaces/vst/ivstcomponent.h>
+#include <pluginterfaces/vst/ivstaudioprocessor.h>
+#include <pluginterfaces/vst/ivsteditcontroller.h>
+#include <pluginterfaces/vst/vstspeaker.h>
+#include <atomic>
+#include <cstring>
+#include <cwchar>
+
+namespace Steinberg
+{
+	DEF_CLASS_IID(IPluginBase)
+	DEF_CLASS_IID(IPluginFactory)
+
+	namespace Vst
+	{
+		DEF_CLASS_IID(IComponent)
+		DEF_CLASS_IID(IAudioProcessor)
+		DEF_CLASS_IID(IEditController)
+	}
+}
+
+using namespace Steinberg;
+using namespace Steinberg::Vst;
+
+namespace
+{
+	const TUID passThroughClassId = INLINE_UID(0x4D504854, 0x54657374, 0x50617373, 0x54687275);
+	const int32 numChannels = 2;
+	HMODULE moduleHandle = nullptr;
+
+	/**
+	*Checks the file name the module was loaded from.
+	*@param word The text to look for.
+	*@return Wether the path of the module contains word.
+	*/
+	bool moduleNameContains(const wchar_t* word)
+	{
+		wchar_t path[MAX_PATH] = {};
+		GetModuleFileNameW(moduleHandle, path, MAX_PATH);
+		return std::wcsstr(path, word) != nullptr;
+	}
+
+	/**
+	*Copies an ASCII name into a VST3 string.
+	*@param destination The string to copy into.
+	*@param name The null-terminated name to copy.
+	*/
+	void copyName(String128 destination, const char* name)
+	{
+		int index = 0;
+
+		for (; name[index] != 0 && index < 127; index++)
+			destination[index] = (char16) name[index];
+
+		destination[index] = 0;
+	}
+
+	/**
+	* Component, processor and controller in one object, passing stereo audio through unchanged.
+	* It has no parameters, state or editor, and doesn't allocate while processing.
+	*/
+	class PassThroughPlugin : public IComponent, public IAudioProcessor, public IEditController
+	{
+	public:
+		tresult PLUGIN_API queryInterface(const TUID iid, void** obj) override
+		{
+			QUERY_INTERFACE(iid, obj, FUnknown::iid, IComponent)
+			QUERY_INTERFACE(iid, obj, IPluginBase::iid, IComponent)
+			QUERY_INTERFACE(iid, obj, IComponent::iid, IComponent)
+			QUERY_INTERFACE(iid, obj, IAudioProcessor::iid, IAudioProcessor)
+			QUERY_INTERFACE(iid, obj, IEditController::iid, IEditController)
+			*obj = nullptr;
+			return kNoInterface;
+		}
+
+		uint32 PLUGIN_API addRef() override
+		{
+			return ++refCount;
+		}
+
+		uint32 PLUGIN_API release() override
+		{
+			const uint32 count = --refCount;
+
+			if (count == 0)
+				delete this;
+
+			return count;
+		}
+
+		// IPluginBase, shared by the component and the controller
+		tresult PLUGIN_API initialize(FUnknown*) override { return kResultOk; }
+		tresult PLUGIN_API terminate() override { return kResultOk; }
+
+		// IComponent
+		tresult PLUGIN_API getControllerClassId(TUID) override { return kNotImplemented; }
+		tresult PLUGIN_API setIoMode(IoMode) override { return kNotImplemented; }
+		int32 PLUGIN_API getBusCount(MediaType type, BusDirection) override { return type == kAudio ? 1 : 0; }
+		tresult PLUGIN_API getRoutingInfo(RoutingInfo&, RoutingInfo&) override { return kNotImplemented; }
+		tresult PLUGIN_API activateBus(MediaType, BusDirection, int32, TBool) override { return kResultTrue; }
+		tresult PLUGIN_API setActive(TBool) override { return kResultOk; }
+
+		tresult PLUGIN_API getBusInfo(MediaType type, BusDirection direction, int32 index, BusInfo& bus) override
+		{
+			if (type != kAudio || index != 0)
+				return kInvalidArgument;
+
+			bus.mediaType = kAudio;
+			bus.direction = direction;
+			bus.channelCount = numChannels;
+			copyName(bus.name, direction == kInput ? "Input" : "Output");
+			bus.busType = kMain;
+			bus.flags = BusInfo::kDefaultActive;
+			return kResultTrue;
+		}
+
+		// The component and the controller share one stateless implementation.
+		tresult PLUGIN_API setState(IBStream*) override { return kResultOk; }
+		tresult PLUGIN_API getState(IBStream*) override { return kResultOk; }
+
+		// IAudioProcessor
+		uint32 PLUGIN_API getLatencySamples() override { return 0; }
+		uint32 PLUGIN_API getTailSamples() override { return 0; }
+		tresult PLUGIN_API setupProcessing(ProcessSetup&) override { return kResultOk; }
+		tresult PLUGIN_API setProcessing(TBool) override { return kResultOk; }
+
+		tresult PLUGIN_API setBusArrangements(SpeakerArrangement* inputs, int32 numIns, SpeakerArrangement* outputs, int32 numOuts) override
+		{
+			const bool isStereo = numIns == 1 && numOuts == 1 && inputs[0] == SpeakerArr::kStereo && outputs[0] == SpeakerArr::kStereo;
+			return isStereo ? kResultTrue : kResultFalse;
+		}
+
+		tresult PLUGIN_API getBusArrangement(BusDirection, int32 index, SpeakerArrangement& arrangement) override
+		{
+			if (index != 0)
+				return kInvalidArgument;
+
+			arrangement = SpeakerArr::kStereo;
+			return kResultTrue;
+		}
+
+		tresult PLUGIN_API canProcessSampleSize(int32 symbolicSampleSize) override
+		{
+			return symbolicSampleSize == kSample32 ? kResultTrue : kResultFalse;
+		}
+
+		tresult PLUGIN_API process(ProcessData& data) override
+		{
+			if (data.numInputs == 0 || data.numOutputs == 0 || data.symbolicSampleSize != kSample32)
+				return kResultOk;
+
+			const AudioBusBuffers& input = data.inputs[0];
+			const AudioBusBuffers& output = data.outputs[0];
+			const size_t numBytes = sizeof(Sample32) * (size_t) data.numSamples;
+
+			for (int32 channel = 0; channel < output.numChannels; channel++)
+			{
+				Sample32* destination = output.channelBuffers32[channel];
+
+				if (channel >= input.numChannels)
+					std::memset(destination, 0, numBytes);
+				else if (input.channelBuffers32[channel] != destination)
+					std::memmove(destination, input.channelBuffers32[channel], numBytes);
+			}
+
+			return kResultOk;
+		}
+
+		// IEditController
+		tresult PLUGIN_API setComponentState(IBStream*) override { return kResultOk; }
+		int32 PLUGIN_API getParameterCount() override { return 0; }
+		tresult PLUGIN_API getParameterInfo(int32, ParameterInfo&) override { return kInvalidArgument; }
+		tresult PLUGIN_API getParamStringByValue(ParamID, ParamValue, String128) override { return kInvalidArgument; }
+		tresult PLUGIN_API getParamValueByString(ParamID, TChar*, ParamValue&) override { return kInvalidArgument; }
+		ParamValue PLUGIN_API normalizedParamToPlain(ParamID, ParamValue value) override { return value; }
+		ParamValue PLUGIN_API plainParamToNormalized(ParamID, ParamValue value) override { return value; }
+		ParamValue PLUGIN_API getParamNormalized(ParamID) override { return 0.0; }
+		tresult PLUGIN_API setParamNormalized(ParamID, ParamValue) override { return kInvalidArgument; }
+		tresult PLUGIN_API setComponentHandler(IComponentHandler*) override { return kResultOk; }
+		IPlugView* PLUGIN_API createView(FIDString) override { return nullptr; }
+
+	private:
+		std::atomic<uint32> refCount { 1 };
+	};
+
+	/**
+	* The factory of the module, offering the pass-through plugin as its only class.
+	*/
+	class Factory : public IPluginFactory
+	{
+	public:
+		tresult PLUGIN_API queryInterface(const TUID iid, void** obj) override
+		{
+			QUERY_INTERFACE(iid, obj, FUnknown::iid, IPluginFactory)
+			QUERY_INTERFACE(iid, obj, IPluginFactory::iid, IPluginFactory)
+			*obj = nullptr;
+			return kNoInterface;
+		}
+
+		// The factory is a static object living as long as the module, so it isn't reference counted.
+		uint32 PLUGIN_API addRef() override { return 1; }
+		uint32 PLUGIN_API release() override { return 1; }
+
+		tresult PLUGIN_API getFactoryInfo(PFactoryInfo* info) override
+		{
+			*info = PFactoryInfo("MiniPluginHost", "", "", PFactoryInfo::kNoFlags);
+			return kResultOk;
+		}
+
+		int32 PLUGIN_API countClasses() override
+		{
+			return 1;
+		}
+
+		tresult PLUGIN_API getClassInfo(int32 index, PClassInfo* info) override
+		{
+			if (index != 0)
+				return kInvalidArgument;
+
+			*info = PClassInfo(passThroughClassId, PClassInfo::kManyInstances, kVstAudioEffectClass, "MiniPluginHost Test Plugin");
+			return kResultOk;
+		}
+
+		tresult PLUGIN_API createInstance(FIDString cid, FIDString iid, void** obj) override
+		{
+			if (!FUnknownPrivate::iidEqual(cid, passThroughClassId))
+			{
+				*obj = nullptr;
+				return kInvalidArgument;
+			}
+
+			auto* plugin = new PassThroughPlugin();
+			const tresult result = plugin->queryInterface(iid, obj);
+			plugin->release();
+			return result;
+		}
+	};
+}
+
+BOOL WINAPI DllMain(HINSTANCE instance, DWORD reason, LPVOID)
+{
+	if (reason == DLL_PROCESS_ATTACH)
+		moduleHandle = instance;
+
+	return TRUE;
+}
+
+extern "C" __declspec(dllexport) IPluginFactory* PLUGIN_API GetPluginFactory()
+{
+	// The scanner tests copy the module to file names asking it to misbehave the moment a host loads it.
+	if (moduleNameContains(L"Crashing"))
+	{
+		SetErrorMode(SEM_FAILCRITICALERRORS | SEM_NOGPFAULTERRORBOX);
+		RaiseException(EXCEPTION_ACCESS_VIOLATION, EXCEPTION_NONCONTINUABLE, 0, nullptr);
+	}
+
+	while (moduleNameContains(L"Hanging"))
+		Sleep(1000);
+
+	static Factory factory;
+	return &factory;
+}
@@ -0,0 +1,39 @@
+/*
+	==============================================================================
+
+	TestPlugins
+	by Daniel Rothmann
+
+	Locates the test plugin built next to the tests and describes it for instantiation
+
+	==============================================================================
+*/
+
+#include "TestPlugins.h"
+
+/**
+*Gets the pass-through test plugin.
+*@return The plugin file next to the test executable.
+*/
+File TestPlugins::getPassThroughPlugin()
+{
+	return File::getSpecialLocation(File::currentExecutableFile).getSiblingFile("MiniPluginHostTestPlugin.vst3");
+}
+
+/**
+*Scans a test plugin in this process and formats its description like the plugins manager does.
+*@param pluginFile The plugin file to scan.
+*@return A string containing the plugin description formatted as XML, or an empty string if the file holds no plugin.
+*/
+String TestPlugins::createXmlDescription(const File& pluginFile)
+{
+	VST3PluginFormat format;
+	OwnedArray<PluginDescription> found;
+	format.findAllTypesForFile(found, pluginFile.getFullPathName());
+
+	if (found.isEmpty())
+		return "";
+
+	ScopedPointer<XmlElement> xml = found[0]->createXml();
+	return xml->createDocument("");
+}
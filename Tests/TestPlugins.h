@@ -0,0 +1,22 @@
+/*
+	==============================================================================
+
+	TestPlugins
+	by Daniel Rothmann
+
+	Locates the test plugin built next to the tests and describes it for instantiation
+
+	==============================================================================
+*/
+
+#pragma once
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/**
+* Helpers for the VST3 test plugin, which the TestPlugin project builds into the folder of the test executable.
+*/
+namespace TestPlugins
+{
+	File getPassThroughPlugin();
+	String createXmlDescription(const File& pluginFile);
+}